@@ -0,0 +1,103 @@
+/**
+ * @file adjacency.cpp
+ * @brief Compares adjacency lists stored as std::vector of gc_ptr and as gc_vector:
+ * building star graph, connecting second root to it and clearing edges of its hub node.
+ * Edges are filled before hub is connected, because gc_ptr inserted into std::vector of connected object
+ * stays root and is not traced
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class VectorNode {
+ public:
+  std::vector<memory::gc_ptr<VectorNode>> edges_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(edges_)>(edges_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(edges_)>(edges_, isRoot, rootPtr);
+  }
+};
+
+class GcVectorNode {
+ public:
+  memory::gc_vector<GcVectorNode> edges_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(edges_)>(edges_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(edges_)>(edges_, isRoot, rootPtr);
+  }
+};
+
+/**
+ * @brief Hub node with edges to edgesCount leaf nodes
+ */
+template <typename TNode>
+memory::gc_ptr<TNode> makeStar(const std::size_t edgesCount) {
+  decltype(TNode::edges_) edges;
+  edges.reserve(edgesCount);
+  for (std::size_t i = 0; i < edgesCount; ++i) {
+    edges.push_back(memory::make_gc<TNode>());
+  }
+  return memory::make_gc<TNode>(std::move(edges));
+}
+
+template <typename TNode>
+void BM_BuildStar(benchmark::State & state) {
+  const auto edgesCount = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    auto hubPtr = makeStar<TNode>(edgesCount);
+    benchmark::DoNotOptimize(hubPtr.get());
+    state.PauseTiming();
+    hubPtr = nullptr;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TNode>
+void BM_ConnectSecondRoot(benchmark::State & state) {
+  const auto edgesCount = static_cast<std::size_t>(state.range(0));
+  auto hubPtr = makeStar<TNode>(edgesCount);
+  for (auto _ : state) {
+    auto secondRootPtr = hubPtr;
+    benchmark::DoNotOptimize(secondRootPtr.get());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TNode>
+void BM_ClearEdges(benchmark::State & state) {
+  const auto edgesCount = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto hubPtr = makeStar<TNode>(edgesCount);
+    state.ResumeTiming();
+    hubPtr->edges_.clear();
+    state.PauseTiming();
+    hubPtr = nullptr;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_BuildStar, VectorNode)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_BuildStar, GcVectorNode)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_ConnectSecondRoot, VectorNode)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_ConnectSecondRoot, GcVectorNode)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_ClearEdges, VectorNode)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_ClearEdges, GcVectorNode)->RangeMultiplier(10)->Range(10, 100000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,80 @@
+/**
+ * @file allocation.cpp
+ * @brief Measures creation and destruction of short living objects by make_gc, by allocate_gc with gc_pool_allocator
+ * and by adoption of raw pointer with separate and with embedded (gc_enable) control block
+ */
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+template <typename TPolicy>
+class Node {
+ public:
+  using gc_reclamation_policy = TPolicy;
+
+  memory::gc_ptr<Node> next_ptr_;
+  int value_ = 0;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+template <typename TPolicy>
+class IntrusiveNode : public memory::gc_enable<TPolicy> {
+ public:
+  memory::gc_ptr<IntrusiveNode> next_ptr_;
+  int value_ = 0;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+template <typename TPolicy>
+void BM_MakeGc(benchmark::State & state) {
+  for (auto _ : state) {
+    auto nodePtr = memory::make_gc<Node<TPolicy>>();
+    benchmark::DoNotOptimize(nodePtr.get());
+  }
+}
+
+template <typename TPolicy>
+void BM_AllocateGcFromPool(benchmark::State & state) {
+  const memory::gc_pool_allocator<Node<TPolicy>> allocator;
+  for (auto _ : state) {
+    auto nodePtr = memory::allocate_gc<Node<TPolicy>>(allocator);
+    benchmark::DoNotOptimize(nodePtr.get());
+  }
+}
+
+template <typename TNode>
+void BM_AdoptRawPointer(benchmark::State & state) {
+  for (auto _ : state) {
+    memory::gc_ptr<TNode> nodePtr{new TNode{}};
+    benchmark::DoNotOptimize(nodePtr.get());
+  }
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_MakeGc, memory::gc_root_propagation)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_AllocateGcFromPool, memory::gc_root_propagation)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_MakeGc, memory::gc_cycle_collection)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_AllocateGcFromPool, memory::gc_cycle_collection)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_AdoptRawPointer, Node<memory::gc_root_propagation>)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_AdoptRawPointer, IntrusiveNode<memory::gc_root_propagation>)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_AdoptRawPointer, Node<memory::gc_cycle_collection>)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_AdoptRawPointer, IntrusiveNode<memory::gc_cycle_collection>)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,45 @@
+/**
+ * @file allocation_counter.cpp
+ * @brief Replaces global operator new to count allocations
+ */
+
+#include "allocation_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace benchmarks {
+
+std::atomic<std::size_t> g_allocated_bytes{0};
+std::atomic<std::size_t> g_allocations_count{0};
+
+}
+
+void * operator new(std::size_t size) {
+  benchmarks::g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  benchmarks::g_allocations_count.fetch_add(1, std::memory_order_relaxed);
+  if (void * ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void * operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void * ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void * ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void * ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
@@ -0,0 +1,19 @@
+/**
+ * @file allocation_counter.hpp
+ * @brief Counts bytes and number of allocations done by global operator new
+ */
+
+#ifndef GC_PTR_BENCHMARKS_ALLOCATION_COUNTER_HPP
+#define GC_PTR_BENCHMARKS_ALLOCATION_COUNTER_HPP
+
+#include <atomic>
+#include <cstddef>
+
+namespace benchmarks {
+
+extern std::atomic<std::size_t> g_allocated_bytes;
+extern std::atomic<std::size_t> g_allocations_count;
+
+}
+
+#endif  //GC_PTR_BENCHMARKS_ALLOCATION_COUNTER_HPP
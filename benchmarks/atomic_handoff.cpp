@@ -0,0 +1,80 @@
+/**
+ * @file atomic_handoff.cpp
+ * @brief Measures load and exchange of one atomic_gc_ptr shared by many threads
+ * against std::atomic_load() and std::atomic_exchange() of std::shared_ptr
+ */
+
+#include <atomic>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+  int value_ = 0;
+
+  GC_TRACE_FIELDS(next_ptr_)
+};
+
+struct SharedNode {
+  std::shared_ptr<SharedNode> next_ptr_;
+  int value_ = 0;
+};
+
+memory::atomic_gc_ptr<Node> g_atomic_gc_ptr;
+std::shared_ptr<SharedNode> g_shared_ptr;
+
+void BM_AtomicGcPtrLoad(benchmark::State & state) {
+  if (state.thread_index() == 0) {
+    g_atomic_gc_ptr.store(memory::make_gc<Node>());
+  }
+  for (auto _ : state) {
+    auto nodePtr = g_atomic_gc_ptr.load();
+    benchmark::DoNotOptimize(nodePtr.get());
+  }
+  if (state.thread_index() == 0) {
+    g_atomic_gc_ptr.store(memory::gc_ptr<Node>{});
+  }
+}
+
+void BM_AtomicGcPtrExchange(benchmark::State & state) {
+  auto nodePtr = memory::make_gc<Node>();
+  for (auto _ : state) {
+    nodePtr = g_atomic_gc_ptr.exchange(std::move(nodePtr));
+    benchmark::DoNotOptimize(nodePtr.get());
+  }
+}
+
+void BM_SharedPtrAtomicLoad(benchmark::State & state) {
+  if (state.thread_index() == 0) {
+    std::atomic_store(&g_shared_ptr, std::make_shared<SharedNode>());
+  }
+  for (auto _ : state) {
+    auto nodePtr = std::atomic_load(&g_shared_ptr);
+    benchmark::DoNotOptimize(nodePtr.get());
+  }
+  if (state.thread_index() == 0) {
+    std::atomic_store(&g_shared_ptr, std::shared_ptr<SharedNode>{});
+  }
+}
+
+void BM_SharedPtrAtomicExchange(benchmark::State & state) {
+  auto nodePtr = std::make_shared<SharedNode>();
+  for (auto _ : state) {
+    nodePtr = std::atomic_exchange(&g_shared_ptr, std::move(nodePtr));
+    benchmark::DoNotOptimize(nodePtr.get());
+  }
+}
+
+}
+
+BENCHMARK(BM_AtomicGcPtrLoad)->ThreadRange(1, 8);
+BENCHMARK(BM_SharedPtrAtomicLoad)->ThreadRange(1, 8);
+BENCHMARK(BM_AtomicGcPtrExchange)->ThreadRange(1, 8);
+BENCHMARK(BM_SharedPtrAtomicExchange)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+/**
+ * @file batch_scope.cpp
+ * @brief Measures burst of assignments that point root gc_ptr to head of linked list and back to other list,
+ * with and without gc::batch_scope around the burst. Assignment of field is applied right away even inside of
+ * batch, so only roots are reassigned
+ */
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+constexpr std::size_t kBurstSize = 1000;
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+memory::gc_ptr<Node> makeList(const std::size_t nodesCount) {
+  auto headPtr = memory::make_gc<Node>();
+  Node * nodePtr = headPtr.get();
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_ptr_.get();
+  }
+  return headPtr;
+}
+
+void assignBurst(memory::gc_ptr<Node> & holderPtr,
+                 const memory::gc_ptr<Node> & firstPtr,
+                 const memory::gc_ptr<Node> & secondPtr) {
+  for (std::size_t i = 0; i < kBurstSize; ++i) {
+    holderPtr = firstPtr;
+    holderPtr = secondPtr;
+  }
+}
+
+void BM_AssignBurst(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  memory::gc_ptr<Node> holderPtr;
+  const auto firstPtr = makeList(nodesCount);
+  const auto secondPtr = makeList(nodesCount);
+  for (auto _ : state) {
+    assignBurst(holderPtr, firstPtr, secondPtr);
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * kBurstSize);
+}
+
+void BM_AssignBurstInBatchScope(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  memory::gc_ptr<Node> holderPtr;
+  const auto firstPtr = makeList(nodesCount);
+  const auto secondPtr = makeList(nodesCount);
+  for (auto _ : state) {
+    memory::gc::batch_scope batch;
+    assignBurst(holderPtr, firstPtr, secondPtr);
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * kBurstSize);
+}
+
+}
+
+BENCHMARK(BM_AssignBurst)->RangeMultiplier(10)->Range(1, 1000);
+BENCHMARK(BM_AssignBurstInBatchScope)->RangeMultiplier(10)->Range(1, 1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,86 @@
+/**
+ * @file borrowed_parameter.cpp
+ * @brief Measures call of function that takes head of linked list as gc_ptr by value, as const reference
+ * to gc_ptr and as gc_ref
+ */
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+  int value_ = 1;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+memory::gc_ptr<Node> makeList(const std::size_t nodesCount) {
+  auto headPtr = memory::make_gc<Node>();
+  Node * nodePtr = headPtr.get();
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_ptr_.get();
+  }
+  return headPtr;
+}
+
+__attribute__((noinline)) int valueByGcPtr(memory::gc_ptr<Node> nodePtr) {
+  return nodePtr->value_;
+}
+
+__attribute__((noinline)) int valueByConstReference(const memory::gc_ptr<Node> & nodePtr) {
+  return nodePtr->value_;
+}
+
+__attribute__((noinline)) int valueByGcRef(memory::gc_ref<Node> nodeRef) {
+  return nodeRef->value_;
+}
+
+template <int (*Function)(const memory::gc_ptr<Node> &)>
+void measureCall(benchmark::State & state) {
+  auto headPtr = makeList(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Function(headPtr));
+  }
+}
+
+int callByGcPtr(const memory::gc_ptr<Node> & headPtr) {
+  return valueByGcPtr(headPtr);
+}
+
+int callByConstReference(const memory::gc_ptr<Node> & headPtr) {
+  return valueByConstReference(headPtr);
+}
+
+int callByGcRef(const memory::gc_ptr<Node> & headPtr) {
+  return valueByGcRef(headPtr);
+}
+
+void BM_PassGcPtrByValue(benchmark::State & state) {
+  measureCall<&callByGcPtr>(state);
+}
+
+void BM_PassConstReference(benchmark::State & state) {
+  measureCall<&callByConstReference>(state);
+}
+
+void BM_PassGcRef(benchmark::State & state) {
+  measureCall<&callByGcRef>(state);
+}
+
+}
+
+BENCHMARK(BM_PassGcPtrByValue)->RangeMultiplier(10)->Range(1, 10000);
+BENCHMARK(BM_PassConstReference)->RangeMultiplier(10)->Range(1, 10000);
+BENCHMARK(BM_PassGcRef)->RangeMultiplier(10)->Range(1, 10000);
+
+BENCHMARK_MAIN();
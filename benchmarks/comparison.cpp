@@ -0,0 +1,354 @@
+/**
+ * @file comparison.cpp
+ * @brief Compares gc_ptr with both reclamation policies against std::shared_ptr and raw pointers.
+ * Every benchmark reports time per operation, allocations per operation and allocated bytes per object
+ */
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+#include "allocation_counter.hpp"
+
+namespace {
+
+constexpr std::size_t kFanOut = 8;
+constexpr std::size_t kBatchSize = 1024;
+
+template <typename TPolicy>
+class GcNode {
+ public:
+  using gc_reclamation_policy = TPolicy;
+
+  memory::gc_ptr<GcNode> next_ptr_;
+  memory::gc_ptr<GcNode> other_ptr_;
+  int value_ = 0;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+    memory::call_ConnectFieldToRoot<decltype(other_ptr_)>(other_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+    memory::call_DisconnectFieldFromRoot<decltype(other_ptr_)>(other_ptr_, isRoot, rootPtr);
+  }
+};
+
+template <typename TPolicy>
+class GcWideNode {
+ public:
+  using gc_reclamation_policy = TPolicy;
+
+  std::array<memory::gc_ptr<GcWideNode>, kFanOut> children_;
+
+  void connectToRoot(const void * rootPtr) const {
+    for (auto & childPtr : children_) {
+      memory::call_ConnectFieldToRoot<memory::gc_ptr<GcWideNode>>(childPtr, rootPtr);
+    }
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    for (auto & childPtr : children_) {
+      memory::call_DisconnectFieldFromRoot<memory::gc_ptr<GcWideNode>>(childPtr, isRoot, rootPtr);
+    }
+  }
+};
+
+template <typename TPolicy>
+struct gc_pointers {
+  using node = GcNode<TPolicy>;
+  using pointer = memory::gc_ptr<node>;
+  using wide_node = GcWideNode<TPolicy>;
+  using wide_pointer = memory::gc_ptr<wide_node>;
+
+  template <typename TNode>
+  static memory::gc_ptr<TNode> make() {
+    return memory::make_gc<TNode>();
+  }
+
+  template <typename TPointer>
+  static void destroy(TPointer & ptr) {
+    ptr = nullptr;
+  }
+
+  static void destroyCycle(pointer & ptr) {
+    ptr = nullptr;
+  }
+};
+
+struct SharedNode {
+  std::shared_ptr<SharedNode> next_ptr_;
+  std::shared_ptr<SharedNode> other_ptr_;
+  int value_ = 0;
+};
+
+struct SharedWideNode {
+  std::array<std::shared_ptr<SharedWideNode>, kFanOut> children_;
+};
+
+struct shared_pointers {
+  using node = SharedNode;
+  using pointer = std::shared_ptr<node>;
+  using wide_node = SharedWideNode;
+  using wide_pointer = std::shared_ptr<wide_node>;
+
+  template <typename TNode>
+  static std::shared_ptr<TNode> make() {
+    return std::make_shared<TNode>();
+  }
+
+  template <typename TPointer>
+  static void destroy(TPointer & ptr) {
+    ptr = nullptr;
+  }
+
+  // NOTE(redra): std::shared_ptr can not reclaim cycle, so it is broken by hand
+  static void destroyCycle(pointer & ptr) {
+    ptr->next_ptr_->next_ptr_ = nullptr;
+    ptr = nullptr;
+  }
+};
+
+struct RawNode {
+  RawNode * next_ptr_ = nullptr;
+  RawNode * other_ptr_ = nullptr;
+  int value_ = 0;
+};
+
+struct RawWideNode {
+  std::array<RawWideNode *, kFanOut> children_{};
+};
+
+struct raw_pointers {
+  using node = RawNode;
+  using pointer = RawNode *;
+  using wide_node = RawWideNode;
+  using wide_pointer = RawWideNode *;
+
+  template <typename TNode>
+  static TNode * make() {
+    return new TNode{};
+  }
+
+  static void destroy(pointer & ptr) {
+    while (ptr != nullptr) {
+      pointer nextPtr = ptr->next_ptr_;
+      delete ptr;
+      ptr = nextPtr;
+    }
+  }
+
+  static void destroy(wide_pointer & ptr) {
+    if (ptr != nullptr) {
+      for (auto & childPtr : ptr->children_) {
+        destroy(childPtr);
+      }
+      delete ptr;
+      ptr = nullptr;
+    }
+  }
+
+  static void destroyCycle(pointer & ptr) {
+    delete ptr->next_ptr_;
+    delete ptr;
+    ptr = nullptr;
+  }
+};
+
+template <typename TPointer>
+auto rawPtr(const TPointer & ptr) {
+  if constexpr (std::is_pointer<TPointer>::value) {
+    return ptr;
+  } else {
+    return ptr.get();
+  }
+}
+
+/**
+ * @brief Reports allocations and allocated bytes done inside of its scope per operation and per object
+ */
+class allocation_report {
+ public:
+  explicit allocation_report(benchmark::State & state)
+      : state_{state},
+        allocations_count_{benchmarks::g_allocations_count.load()},
+        allocated_bytes_{benchmarks::g_allocated_bytes.load()} {
+  }
+
+  void finish(const double operationsCount, const double objectsCount) {
+    const auto allocationsCount = benchmarks::g_allocations_count.load() - allocations_count_;
+    const auto allocatedBytes = benchmarks::g_allocated_bytes.load() - allocated_bytes_;
+    state_.counters["allocs/op"] = static_cast<double>(allocationsCount) / operationsCount;
+    if (objectsCount > 0) {
+      state_.counters["bytes/object"] = static_cast<double>(allocatedBytes) / objectsCount;
+    }
+    state_.counters["time/op"] =
+        benchmark::Counter(operationsCount, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  }
+
+ private:
+  benchmark::State & state_;
+  const std::size_t allocations_count_;
+  const std::size_t allocated_bytes_;
+};
+
+template <typename TPointers>
+void BM_MakeAndDestroy(benchmark::State & state) {
+  allocation_report report{state};
+  for (auto _ : state) {
+    auto ptr = TPointers::template make<typename TPointers::node>();
+    benchmark::DoNotOptimize(rawPtr(ptr));
+    TPointers::destroy(ptr);
+  }
+  report.finish(state.iterations(), state.iterations());
+}
+
+template <typename TPointers>
+void BM_Destroy(benchmark::State & state) {
+  std::vector<typename TPointers::pointer> ptrs(kBatchSize);
+  allocation_report report{state};
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (auto & ptr : ptrs) {
+      ptr = TPointers::template make<typename TPointers::node>();
+    }
+    state.ResumeTiming();
+    for (auto & ptr : ptrs) {
+      TPointers::destroy(ptr);
+    }
+  }
+  report.finish(state.iterations() * kBatchSize, state.iterations() * kBatchSize);
+}
+
+template <typename TPointers>
+void BM_Copy(benchmark::State & state) {
+  auto ptr = TPointers::template make<typename TPointers::node>();
+  allocation_report report{state};
+  for (auto _ : state) {
+    auto copyPtr = ptr;
+    benchmark::DoNotOptimize(rawPtr(copyPtr));
+  }
+  report.finish(state.iterations(), 0);
+  TPointers::destroy(ptr);
+}
+
+template <typename TPointers>
+void BM_Assign(benchmark::State & state) {
+  auto holderPtr = TPointers::template make<typename TPointers::node>();
+  auto firstPtr = TPointers::template make<typename TPointers::node>();
+  auto secondPtr = TPointers::template make<typename TPointers::node>();
+  allocation_report report{state};
+  for (auto _ : state) {
+    holderPtr->other_ptr_ = firstPtr;
+    benchmark::ClobberMemory();
+    holderPtr->other_ptr_ = secondPtr;
+    benchmark::ClobberMemory();
+  }
+  report.finish(2 * state.iterations(), 0);
+  holderPtr->other_ptr_ = nullptr;
+  TPointers::destroy(holderPtr);
+  TPointers::destroy(firstPtr);
+  TPointers::destroy(secondPtr);
+}
+
+template <typename TPointers>
+void BM_CycleCreateAndTeardown(benchmark::State & state) {
+  allocation_report report{state};
+  for (auto _ : state) {
+    auto firstPtr = TPointers::template make<typename TPointers::node>();
+    firstPtr->next_ptr_ = TPointers::template make<typename TPointers::node>();
+    firstPtr->next_ptr_->next_ptr_ = firstPtr;
+    benchmark::DoNotOptimize(rawPtr(firstPtr->next_ptr_));
+    TPointers::destroyCycle(firstPtr);
+  }
+  memory::gc::collect_cycles();
+  report.finish(state.iterations(), 2 * state.iterations());
+}
+
+template <typename TPointers>
+void BM_DeepChain(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  allocation_report report{state};
+  for (auto _ : state) {
+    auto headPtr = TPointers::template make<typename TPointers::node>();
+    auto nodePtr = rawPtr(headPtr);
+    for (std::size_t i = 1; i < nodesCount; ++i) {
+      nodePtr->next_ptr_ = TPointers::template make<typename TPointers::node>();
+      nodePtr = rawPtr(nodePtr->next_ptr_);
+    }
+    TPointers::destroy(headPtr);
+  }
+  report.finish(state.iterations() * nodesCount, state.iterations() * nodesCount);
+}
+
+template <typename TPointers>
+void BM_WideFanOut(benchmark::State & state) {
+  using wide_node = typename TPointers::wide_node;
+  const auto depth = static_cast<std::size_t>(state.range(0));
+  std::size_t nodesCount = 0;
+  allocation_report report{state};
+  for (auto _ : state) {
+    auto rootPtr = TPointers::template make<wide_node>();
+    std::vector<wide_node *> level{rawPtr(rootPtr)};
+    nodesCount = 1;
+    for (std::size_t d = 1; d < depth; ++d) {
+      std::vector<wide_node *> nextLevel;
+      for (auto nodePtr : level) {
+        for (auto & childPtr : nodePtr->children_) {
+          childPtr = TPointers::template make<wide_node>();
+          nextLevel.push_back(rawPtr(childPtr));
+        }
+      }
+      nodesCount += nextLevel.size();
+      level.swap(nextLevel);
+    }
+    TPointers::destroy(rootPtr);
+  }
+  report.finish(state.iterations() * nodesCount, state.iterations() * nodesCount);
+}
+
+template <typename TPointers>
+void BM_MultiThreadedSharing(benchmark::State & state) {
+  static typename TPointers::pointer sharedPtr;
+  if (state.thread_index() == 0) {
+    sharedPtr = TPointers::template make<typename TPointers::node>();
+  }
+  for (auto _ : state) {
+    auto copyPtr = sharedPtr;
+    benchmark::DoNotOptimize(rawPtr(copyPtr));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    TPointers::destroy(sharedPtr);
+  }
+}
+
+using gc_root_propagation_pointers = gc_pointers<memory::gc_root_propagation>;
+using gc_cycle_collection_pointers = gc_pointers<memory::gc_cycle_collection>;
+
+}
+
+#define GC_PTR_COMPARISON_BENCHMARK(name, arguments) \
+  BENCHMARK_TEMPLATE(name, raw_pointers)arguments; \
+  BENCHMARK_TEMPLATE(name, shared_pointers)arguments; \
+  BENCHMARK_TEMPLATE(name, gc_root_propagation_pointers)arguments; \
+  BENCHMARK_TEMPLATE(name, gc_cycle_collection_pointers)arguments
+
+GC_PTR_COMPARISON_BENCHMARK(BM_MakeAndDestroy, );
+GC_PTR_COMPARISON_BENCHMARK(BM_Destroy, );
+GC_PTR_COMPARISON_BENCHMARK(BM_Copy, );
+GC_PTR_COMPARISON_BENCHMARK(BM_Assign, );
+
+// NOTE(redra): Raw pointers do not own objects, so cycle is deleted by hand the same way as std::shared_ptr cycle
+GC_PTR_COMPARISON_BENCHMARK(BM_CycleCreateAndTeardown, );
+
+// NOTE(redra): Destruction of std::shared_ptr chain is recursive, so chains are kept short enough for its stack
+GC_PTR_COMPARISON_BENCHMARK(BM_DeepChain, ->RangeMultiplier(10)->Range(10, 10000));
+GC_PTR_COMPARISON_BENCHMARK(BM_WideFanOut, ->DenseRange(2, 4));
+GC_PTR_COMPARISON_BENCHMARK(BM_MultiThreadedSharing, ->ThreadRange(1, 8));
+
+BENCHMARK_MAIN();
@@ -0,0 +1,113 @@
+/**
+ * @file contention.cpp
+ * @brief Measures gc_ptr stores of one shared object from many threads
+ * for control block in lock-free single root state and in spilled root table state.
+ * contention_tas target builds it with memory::sync::TasLock as GC_LOCK_TYPE and
+ * contention_lock_stats target reports lock counters
+ */
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+  memory::gc_ptr<Node> extra_ptr_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+    memory::call_ConnectFieldToRoot<decltype(extra_ptr_)>(extra_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+    memory::call_DisconnectFieldFromRoot<decltype(extra_ptr_)>(extra_ptr_, isRoot, rootPtr);
+  }
+};
+
+constexpr int kMaxThreadsCount = 64;
+
+/**
+ * @brief Graph reachable from single root: root -> shared node, root -> chain of child node per thread
+ */
+struct shared_graph {
+  memory::gc_ptr<Node> root_ptr_;
+  memory::gc_ptr<Node> second_root_ptr_;
+  std::vector<Node *> children_;
+};
+
+std::unique_ptr<shared_graph> g_graph;
+
+void makeGraph(const bool isSpilled) {
+  g_graph = std::make_unique<shared_graph>();
+  g_graph->root_ptr_ = memory::make_gc<Node>();
+  g_graph->root_ptr_->extra_ptr_ = memory::make_gc<Node>();
+  if (isSpilled) {
+    // NOTE(redra): Second distinct root moves shared node control block to locked root table
+    g_graph->second_root_ptr_ = g_graph->root_ptr_->extra_ptr_;
+  }
+  Node * nodePtr = g_graph->root_ptr_.get();
+  for (int i = 0; i < kMaxThreadsCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_ptr_.get();
+    g_graph->children_.push_back(nodePtr);
+  }
+}
+
+void setupSingleRoot(const benchmark::State &) {
+  makeGraph(false);
+}
+
+void setupSpilledRoots(const benchmark::State &) {
+  makeGraph(true);
+}
+
+void teardownGraph(const benchmark::State &) {
+  g_graph.reset();
+}
+
+void storeSharedPtr(benchmark::State & state) {
+  Node * childPtr = g_graph->children_[state.thread_index()];
+  const memory::gc_ptr<Node> & sharedPtr = g_graph->root_ptr_->extra_ptr_;
+#ifdef GC_ENABLE_LOCK_STATS
+  const auto lockStatsBefore = memory::gc::lock_stats();
+#endif
+  for (auto _ : state) {
+    childPtr->extra_ptr_ = sharedPtr;
+    childPtr->extra_ptr_ = nullptr;
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+#ifdef GC_ENABLE_LOCK_STATS
+  if (state.thread_index() == 0) {
+    // NOTE(redra): Counters are global, so they are reported once for all threads of benchmark
+    const auto lockStatsAfter = memory::gc::lock_stats();
+    const auto threadsCount = static_cast<double>(state.threads());
+    state.counters["contended"] = benchmark::Counter(
+        threadsCount * (lockStatsAfter.contended_count_ - lockStatsBefore.contended_count_), benchmark::Counter::kAvgIterations);
+    state.counters["parks"] = benchmark::Counter(
+        threadsCount * (lockStatsAfter.park_count_ - lockStatsBefore.park_count_), benchmark::Counter::kAvgIterations);
+  }
+#endif
+}
+
+void BM_StoreSharedSingleRoot(benchmark::State & state) {
+  storeSharedPtr(state);
+}
+
+void BM_StoreSharedSpilledRoots(benchmark::State & state) {
+  storeSharedPtr(state);
+}
+
+}
+
+BENCHMARK(BM_StoreSharedSingleRoot)
+    ->Setup(setupSingleRoot)->Teardown(teardownGraph)->ThreadRange(1, kMaxThreadsCount)->UseRealTime();
+BENCHMARK(BM_StoreSharedSpilledRoots)
+    ->Setup(setupSpilledRoots)->Teardown(teardownGraph)->ThreadRange(1, kMaxThreadsCount)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,73 @@
+/**
+ * @file deep_list.cpp
+ * @brief Stress test of root propagation through deep linked list: building list, connecting second root
+ * to its head and destroying it with constant stack depth
+ */
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+memory::gc_ptr<Node> makeList(const std::size_t nodesCount) {
+  auto headPtr = memory::make_gc<Node>();
+  Node * nodePtr = headPtr.get();
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_ptr_.get();
+  }
+  return headPtr;
+}
+
+void BM_BuildList(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    auto headPtr = makeList(nodesCount);
+    state.PauseTiming();
+    headPtr = nullptr;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ConnectSecondRoot(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  auto headPtr = makeList(nodesCount);
+  for (auto _ : state) {
+    auto secondRootPtr = headPtr;
+    benchmark::DoNotOptimize(secondRootPtr.get());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_DestroyList(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto headPtr = makeList(nodesCount);
+    state.ResumeTiming();
+    headPtr = nullptr;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK(BM_BuildList)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ConnectSecondRoot)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DestroyList)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+/**
+ * @file deferred_destruction.cpp
+ * @brief Measures latency of dropping the last pointer to a chain of objects
+ * when chain is destroyed inline and when its destruction is deferred to gc::drain()
+ */
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  using gc_reclamation_policy = memory::gc_cycle_collection;
+
+  memory::gc_ptr<Node> next_ptr_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+memory::gc_ptr<Node> makeChain(const std::size_t nodesCount) {
+  auto headPtr = memory::make_gc<Node>();
+  Node * nodePtr = headPtr.get();
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_ptr_.get();
+  }
+  return headPtr;
+}
+
+void dropChain(benchmark::State & state, const memory::gc_destruction_mode mode) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  memory::gc::set_destruction_mode(mode);
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto headPtr = makeChain(nodesCount);
+    state.ResumeTiming();
+    headPtr = nullptr;
+    state.PauseTiming();
+    memory::gc::drain();
+    state.ResumeTiming();
+  }
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::immediate);
+}
+
+void BM_DropChainImmediate(benchmark::State & state) {
+  dropChain(state, memory::gc_destruction_mode::immediate);
+}
+
+void BM_DropChainDeferred(benchmark::State & state) {
+  dropChain(state, memory::gc_destruction_mode::deferred);
+}
+
+}
+
+BENCHMARK(BM_DropChainImmediate)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK(BM_DropChainDeferred)->RangeMultiplier(10)->Range(10, 10000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,95 @@
+/**
+ * @file edge_update.cpp
+ * @brief Measures cost of single gc_ptr store into graph reachable from root
+ * for gc_root_propagation and gc_cycle_collection policies
+ */
+
+#include <chrono>
+#include <cstdio>
+
+#include <gc_ptr.hpp>
+
+namespace {
+
+template <typename TPolicy>
+class Node {
+ public:
+  using gc_reclamation_policy = TPolicy;
+
+  memory::gc_ptr<Node> next_ptr_;
+  memory::gc_ptr<Node> extra_ptr_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+    memory::call_ConnectFieldToRoot<decltype(extra_ptr_)>(extra_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+    memory::call_DisconnectFieldFromRoot<decltype(extra_ptr_)>(extra_ptr_, isRoot, rootPtr);
+  }
+};
+
+/**
+ * @brief Builds list of nodesCount nodes and repeatedly stores and clears pointer to sublist in head
+ */
+template <typename TPolicy>
+double measureNanosecondsPerStore(const std::size_t nodesCount) {
+  constexpr std::size_t kStoresCount = 200;
+  auto headPtr = memory::make_gc<Node<TPolicy>>();
+  auto tailPtr = memory::make_gc<Node<TPolicy>>();
+  auto nodePtr = tailPtr;
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node<TPolicy>>();
+    nodePtr = nodePtr->next_ptr_;
+  }
+  nodePtr = memory::gc_ptr<Node<TPolicy>>{};
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kStoresCount; ++i) {
+    headPtr->extra_ptr_ = tailPtr;
+    headPtr->extra_ptr_ = nullptr;
+  }
+  const auto finish = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(finish - start).count() / (2 * kStoresCount);
+}
+
+/**
+ * @brief Repeatedly stores pointer to the object that is already stored, into field and into root
+ */
+template <typename TPolicy>
+double measureNanosecondsPerSameStore(const std::size_t nodesCount) {
+  constexpr std::size_t kStoresCount = 200;
+  auto headPtr = memory::make_gc<Node<TPolicy>>();
+  auto nodePtr = headPtr;
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node<TPolicy>>();
+    nodePtr = nodePtr->next_ptr_;
+  }
+  headPtr->extra_ptr_ = headPtr->next_ptr_;
+  auto cursorPtr = headPtr;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kStoresCount; ++i) {
+    headPtr->extra_ptr_ = headPtr->next_ptr_;
+    cursorPtr = headPtr;
+  }
+  const auto finish = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(finish - start).count() / (2 * kStoresCount);
+}
+
+}
+
+int main() {
+  std::printf("%8s %24s %24s\n", "nodes", "gc_root_propagation ns", "gc_cycle_collection ns");
+  for (std::size_t nodesCount : {1, 10, 100, 1000}) {
+    std::printf("%8zu %24.1f %24.1f\n", nodesCount,
+                measureNanosecondsPerStore<memory::gc_root_propagation>(nodesCount),
+                measureNanosecondsPerStore<memory::gc_cycle_collection>(nodesCount));
+  }
+  std::printf("\n%8s %24s %24s\n", "nodes", "same object ns", "same object ns");
+  for (std::size_t nodesCount : {1, 10, 100, 1000}) {
+    std::printf("%8zu %24.1f %24.1f\n", nodesCount,
+                measureNanosecondsPerSameStore<memory::gc_root_propagation>(nodesCount),
+                measureNanosecondsPerSameStore<memory::gc_cycle_collection>(nodesCount));
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file false_sharing.cpp
+ * @brief Measures reads of fields of one shared object from many threads while other thread keeps copying gc_ptr
+ * to it, for object created with gc_compact_layout and with gc_padded_layout
+ */
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+template <typename TLayout>
+class Node {
+ public:
+  using gc_storage_layout = TLayout;
+
+  std::array<int, 4> values_{1, 2, 3, 4};
+
+  void connectToRoot(const void *) const {
+  }
+
+  void disconnectFromRoot(const bool, const void *) const {
+  }
+};
+
+template <typename TLayout>
+std::unique_ptr<memory::gc_ptr<Node<TLayout>>> g_node_ptr;
+
+std::atomic<bool> g_is_writing{false};
+std::thread g_writer;
+
+/**
+ * @brief Starts writer thread that copies gc_ptr to shared object, so root table and lock of its control block
+ * are written all the time while benchmark threads read object fields
+ */
+template <typename TLayout>
+void setupNode(const benchmark::State &) {
+  g_node_ptr<TLayout> = std::make_unique<memory::gc_ptr<Node<TLayout>>>(memory::make_gc<Node<TLayout>>());
+  g_is_writing = true;
+  g_writer = std::thread{[] {
+    const memory::gc_ptr<Node<TLayout>> & nodePtr = *g_node_ptr<TLayout>;
+    while (g_is_writing.load(std::memory_order_relaxed)) {
+      memory::gc_ptr<Node<TLayout>> copyPtr = nodePtr;
+      benchmark::DoNotOptimize(copyPtr.get());
+    }
+  }};
+}
+
+template <typename TLayout>
+void teardownNode(const benchmark::State &) {
+  g_is_writing = false;
+  g_writer.join();
+  g_node_ptr<TLayout>.reset();
+}
+
+template <typename TLayout>
+void BM_ReadWhileCopying(benchmark::State & state) {
+  const Node<TLayout> * const objectPtr = g_node_ptr<TLayout>->get();
+  for (auto _ : state) {
+    int sum = 0;
+    for (const int & value : objectPtr->values_) {
+      sum += *static_cast<const volatile int *>(&value);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_ReadWhileCopying, memory::gc_compact_layout)
+    ->Setup(setupNode<memory::gc_compact_layout>)
+    ->Teardown(teardownNode<memory::gc_compact_layout>)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ReadWhileCopying, memory::gc_padded_layout)
+    ->Setup(setupNode<memory::gc_padded_layout>)
+    ->Teardown(teardownNode<memory::gc_padded_layout>)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,60 @@
+/**
+ * @file parallel_teardown.cpp
+ * @brief Measures destruction of large unreachable list of objects with heap payload
+ * by one thread and by several threads of gc_destruction_mode::parallel
+ */
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+  std::vector<std::string> payload_ = std::vector<std::string>(4, std::string(64, 'x'));
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+memory::gc_ptr<Node> makeList(const std::size_t nodesCount) {
+  auto headPtr = memory::make_gc<Node>();
+  Node * nodePtr = headPtr.get();
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_ptr_.get();
+  }
+  return headPtr;
+}
+
+template <memory::gc_destruction_mode kMode>
+void BM_DestroyList(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  memory::gc::set_destruction_mode(kMode);
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto headPtr = makeList(nodesCount);
+    state.ResumeTiming();
+    headPtr = nullptr;
+  }
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::immediate);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_DestroyList, memory::gc_destruction_mode::immediate)
+    ->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DestroyList, memory::gc_destruction_mode::parallel)
+    ->RangeMultiplier(10)->Range(10000, 1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
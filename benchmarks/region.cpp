@@ -0,0 +1,67 @@
+/**
+ * @file region.cpp
+ * @brief Measures destruction of request-scoped linked list by removal of its root
+ * and by destruction of gc_region the list was allocated in
+ */
+
+#include <optional>
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+  int value_ = 0;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+memory::gc_ptr<Node> makeList(const std::size_t nodesCount) {
+  auto headPtr = memory::make_gc<Node>();
+  Node * nodePtr = headPtr.get();
+  for (std::size_t i = 1; i < nodesCount; ++i) {
+    nodePtr->next_ptr_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_ptr_.get();
+  }
+  return headPtr;
+}
+
+void BM_DestroyList(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto headPtr = makeList(nodesCount);
+    state.ResumeTiming();
+    headPtr = nullptr;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_DestroyRegion(benchmark::State & state) {
+  const auto nodesCount = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::optional<memory::gc_region> region;
+    region.emplace();
+    region->keep(makeList(nodesCount));
+    state.ResumeTiming();
+    region.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK(BM_DestroyList)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DestroyRegion)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,93 @@
+/**
+ * @file root_set_memory.cpp
+ * @brief Measures memory per gc_ptr for current gc_root_set and for previous std::unordered_set layout
+ */
+
+#include <cstdio>
+#include <unordered_set>
+
+#include <gc_ptr.hpp>
+
+#include "allocation_counter.hpp"
+
+using benchmarks::g_allocated_bytes;
+
+namespace {
+
+// NOTE(redra): Layout of gc_ptr before gc_root_set was introduced
+template <typename TObject>
+struct unordered_set_gc_ptr_layout {
+  mutable bool is_root_ = true;
+  mutable std::unordered_set<const void *> root_ptrs_;
+  mutable TObject * object_ptr_ = nullptr;
+  mutable memory::gc_object_control_block * object_control_block_ptr_ = nullptr;
+};
+
+template <std::size_t InlineCapacity>
+struct root_set_gc_ptr_layout {
+  mutable bool is_root_ = true;
+  mutable memory::gc_root_set<InlineCapacity> root_ptrs_;
+  mutable void * object_ptr_ = nullptr;
+  mutable memory::gc_object_control_block * object_control_block_ptr_ = nullptr;
+};
+
+constexpr std::size_t kPointersCount = 100000;
+constexpr std::size_t kListNodesCount = 100000;
+
+template <typename TLayout>
+double measureBytesPerPointer(const std::size_t rootsCount) {
+  const std::size_t allocatedBefore = g_allocated_bytes.load();
+  auto pointers = new TLayout[kPointersCount];
+  for (std::size_t i = 0; i < kPointersCount; ++i) {
+    for (std::size_t root = 0; root < rootsCount; ++root) {
+      pointers[i].root_ptrs_.insert(memory::make_root_ptr());
+    }
+  }
+  const std::size_t allocatedAfter = g_allocated_bytes.load();
+  delete [] pointers;
+  return static_cast<double>(allocatedAfter - allocatedBefore) / kPointersCount;
+}
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_ptr_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(next_ptr_)>(next_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(next_ptr_)>(next_ptr_, isRoot, rootPtr);
+  }
+};
+
+double measureBytesPerListNode() {
+  const std::size_t allocatedBefore = g_allocated_bytes.load();
+  {
+    auto headPtr = memory::make_gc<Node>();
+    auto nodePtr = headPtr;
+    for (std::size_t i = 1; i < kListNodesCount; ++i) {
+      nodePtr->next_ptr_ = memory::make_gc<Node>();
+      nodePtr = nodePtr->next_ptr_;
+    }
+    const std::size_t allocatedAfter = g_allocated_bytes.load();
+    return static_cast<double>(allocatedAfter - allocatedBefore) / kListNodesCount;
+  }
+}
+
+}
+
+int main() {
+  std::printf("%-28s %8s %14s\n", "layout", "roots", "bytes/pointer");
+  for (std::size_t rootsCount : {1, 2, 3, 4, 8}) {
+    std::printf("%-28s %8zu %14.1f\n", "std::unordered_set", rootsCount,
+                measureBytesPerPointer<unordered_set_gc_ptr_layout<Node>>(rootsCount));
+    std::printf("%-28s %8zu %14.1f\n", "gc_root_set<2>", rootsCount,
+                measureBytesPerPointer<root_set_gc_ptr_layout<2>>(rootsCount));
+    std::printf("%-28s %8zu %14.1f\n", "gc_root_set<4>", rootsCount,
+                measureBytesPerPointer<root_set_gc_ptr_layout<4>>(rootsCount));
+  }
+  std::printf("\nsizeof(gc_ptr<Node>) = %zu\n", sizeof(memory::gc_ptr<Node>));
+  std::printf("allocated bytes per node of list built by make_gc = %.1f\n", measureBytesPerListNode());
+  return 0;
+}
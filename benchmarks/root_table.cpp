@@ -0,0 +1,117 @@
+/**
+ * @file root_table.cpp
+ * @brief Measures memory and lock hold time of gc_object_control_block root table
+ * for current gc_root_table and for previous std::unordered_map layout
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include <gc_ptr.hpp>
+
+#include "allocation_counter.hpp"
+
+using benchmarks::g_allocated_bytes;
+
+namespace {
+
+// NOTE(redra): Layout of gc_object_control_block before gc_root_table was introduced
+struct unordered_map_control_block {
+  const bool is_aligned_memory_ = false;
+  std::atomic_flag lock_object_ = ATOMIC_FLAG_INIT;
+  std::unordered_map<const void *, uint32_t> root_ptrs_;
+
+  bool addRootPtr(const void * rootPtr) {
+    memory::sync::SpinLock lock{lock_object_};
+    const bool isNewRoot = root_ptrs_.count(rootPtr) == 0;
+    if (isNewRoot) {
+      root_ptrs_[rootPtr] = 1;
+    } else {
+      root_ptrs_[rootPtr] += 1;
+    }
+    return isNewRoot;
+  }
+
+  bool removeRootPtr(const void * rootPtr) {
+    memory::sync::SpinLock lock{lock_object_};
+    bool isRemovedRoot = false;
+    if (root_ptrs_.count(rootPtr) > 0) {
+      root_ptrs_[rootPtr] -= 1;
+      if (root_ptrs_[rootPtr] == 0) {
+        root_ptrs_.erase(rootPtr);
+        isRemovedRoot = true;
+      }
+    }
+    return isRemovedRoot;
+  }
+};
+
+struct root_table_control_block {
+  memory::gc_object_control_block control_block_;
+
+  bool addRootPtr(const void * rootPtr) {
+    return control_block_.addRootPtr(rootPtr);
+  }
+
+  bool removeRootPtr(const void * rootPtr) {
+    bool isNoRoots;
+    return control_block_.removeRootPtr(false, rootPtr, isNoRoots);
+  }
+};
+
+constexpr std::size_t kControlBlocksCount = 100000;
+constexpr std::size_t kOperationsCount = 10000000;
+
+template <typename TControlBlock>
+double measureBytesPerControlBlock(const std::vector<const void *> & rootPtrs) {
+  const std::size_t allocatedBefore = g_allocated_bytes.load();
+  auto controlBlocks = new TControlBlock[kControlBlocksCount];
+  for (std::size_t i = 0; i < kControlBlocksCount; ++i) {
+    for (auto rootPtr : rootPtrs) {
+      controlBlocks[i].addRootPtr(rootPtr);
+    }
+  }
+  const std::size_t allocatedAfter = g_allocated_bytes.load();
+  delete [] controlBlocks;
+  return static_cast<double>(allocatedAfter - allocatedBefore) / kControlBlocksCount;
+}
+
+/**
+ * @brief Measures one gc_ptr assignment to already reachable object: root added and removed again
+ */
+template <typename TControlBlock>
+double measureNanosecondsPerAddRemove(const std::vector<const void *> & rootPtrs) {
+  TControlBlock controlBlock;
+  for (auto rootPtr : rootPtrs) {
+    controlBlock.addRootPtr(rootPtr);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kOperationsCount; ++i) {
+    const void * rootPtr = rootPtrs[i % rootPtrs.size()];
+    controlBlock.addRootPtr(rootPtr);
+    controlBlock.removeRootPtr(rootPtr);
+  }
+  const auto finish = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(finish - start).count() / kOperationsCount;
+}
+
+}
+
+int main() {
+  std::printf("%-22s %6s %18s %14s\n", "layout", "roots", "bytes/control_block", "ns/add+remove");
+  for (std::size_t rootsCount : {1, 2, 4, 8}) {
+    std::vector<const void *> rootPtrs;
+    for (std::size_t root = 0; root < rootsCount; ++root) {
+      rootPtrs.push_back(memory::make_root_ptr());
+    }
+    std::printf("%-22s %6zu %18.1f %14.2f\n", "std::unordered_map", rootsCount,
+                measureBytesPerControlBlock<unordered_map_control_block>(rootPtrs),
+                measureNanosecondsPerAddRemove<unordered_map_control_block>(rootPtrs));
+    std::printf("%-22s %6zu %18.1f %14.2f\n", "gc_root_table", rootsCount,
+                measureBytesPerControlBlock<root_table_control_block>(rootPtrs),
+                measureNanosecondsPerAddRemove<root_table_control_block>(rootPtrs));
+  }
+  return 0;
+}
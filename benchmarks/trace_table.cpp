@@ -0,0 +1,80 @@
+/**
+ * @file trace_table.cpp
+ * @brief Compares root propagation through tree of nodes with several gc_ptr fields traced by call per field
+ * and by gc_trace_table
+ */
+
+#include <benchmark/benchmark.h>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class CallNode {
+ public:
+  memory::gc_ptr<CallNode> left_ptr_;
+  memory::gc_ptr<CallNode> right_ptr_;
+  memory::gc_ptr<CallNode> parent_ptr_;
+  memory::gc_ptr<CallNode> sibling_ptr_;
+
+  void connectToRoot(const void * rootPtr) const {
+    memory::call_ConnectFieldToRoot<decltype(left_ptr_)>(left_ptr_, rootPtr);
+    memory::call_ConnectFieldToRoot<decltype(right_ptr_)>(right_ptr_, rootPtr);
+    memory::call_ConnectFieldToRoot<decltype(parent_ptr_)>(parent_ptr_, rootPtr);
+    memory::call_ConnectFieldToRoot<decltype(sibling_ptr_)>(sibling_ptr_, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    memory::call_DisconnectFieldFromRoot<decltype(left_ptr_)>(left_ptr_, isRoot, rootPtr);
+    memory::call_DisconnectFieldFromRoot<decltype(right_ptr_)>(right_ptr_, isRoot, rootPtr);
+    memory::call_DisconnectFieldFromRoot<decltype(parent_ptr_)>(parent_ptr_, isRoot, rootPtr);
+    memory::call_DisconnectFieldFromRoot<decltype(sibling_ptr_)>(sibling_ptr_, isRoot, rootPtr);
+  }
+};
+
+class TableNode {
+ public:
+  memory::gc_ptr<TableNode> left_ptr_;
+  memory::gc_ptr<TableNode> right_ptr_;
+  memory::gc_ptr<TableNode> parent_ptr_;
+  memory::gc_ptr<TableNode> sibling_ptr_;
+
+  using gc_trace_fields = memory::gc_trace_table<&TableNode::left_ptr_, &TableNode::right_ptr_,
+                                                 &TableNode::parent_ptr_, &TableNode::sibling_ptr_>;
+
+  void connectToRoot(const void * rootPtr) const {
+    gc_trace_fields::connectToRoot(this, rootPtr);
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    gc_trace_fields::disconnectFromRoot(this, isRoot, rootPtr);
+  }
+};
+
+template <typename TNode>
+memory::gc_ptr<TNode> makeTree(const std::size_t depth) {
+  auto nodePtr = memory::make_gc<TNode>();
+  if (depth > 1) {
+    nodePtr->left_ptr_ = makeTree<TNode>(depth - 1);
+    nodePtr->right_ptr_ = makeTree<TNode>(depth - 1);
+    nodePtr->left_ptr_->sibling_ptr_ = nodePtr->right_ptr_;
+  }
+  return nodePtr;
+}
+
+template <typename TNode>
+void BM_ConnectSecondRoot(benchmark::State & state) {
+  const auto depth = static_cast<std::size_t>(state.range(0));
+  auto rootPtr = makeTree<TNode>(depth);
+  for (auto _ : state) {
+    auto secondRootPtr = rootPtr;
+    benchmark::DoNotOptimize(secondRootPtr.get());
+  }
+  state.SetItemsProcessed(state.iterations() * ((std::int64_t{1} << depth) - 1));
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_ConnectSecondRoot, CallNode)->DenseRange(8, 16, 4);
+BENCHMARK_TEMPLATE(BM_ConnectSecondRoot, TableNode)->DenseRange(8, 16, 4);
+
+BENCHMARK_MAIN();
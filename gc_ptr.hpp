@@ -35,21 +35,103 @@ void call_DisconnectFieldFromRoot(TDeduced & t, const bool isRoot, const void *
 
 }
 
+#include <algorithm>
 #include <atomic>
-#include <unordered_set>
-#include <unordered_map>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef GC_ENABLE_HEAP_DUMP
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+#endif
+
+// NOTE(redra): Runtime counters include lock counters
+#if defined(GC_ENABLE_STATS) && !defined(GC_ENABLE_LOCK_STATS)
+#define GC_ENABLE_LOCK_STATS
+#endif
 
 namespace memory {
 
+/**
+ * @brief Snapshot of lock counters, collected only when GC_ENABLE_LOCK_STATS is defined
+ */
+struct gc_lock_stats {
+  std::uint64_t acquire_count_ = 0;
+  std::uint64_t contended_count_ = 0;
+  std::uint64_t spin_count_ = 0;
+  std::uint64_t yield_count_ = 0;
+  std::uint64_t park_count_ = 0;
+};
+
 namespace sync {
 
+struct LockCounters {
+  std::atomic<std::uint64_t> acquire_count_{0};
+  std::atomic<std::uint64_t> contended_count_{0};
+  std::atomic<std::uint64_t> spin_count_{0};
+  std::atomic<std::uint64_t> yield_count_{0};
+  std::atomic<std::uint64_t> park_count_{0};
+};
+
+inline LockCounters & lockCounters() {
+  static LockCounters lockCounters;
+  return lockCounters;
+}
+
+#ifdef GC_ENABLE_LOCK_STATS
+#define GC_LOCK_STATS_ADD(counter, value) \
+  memory::sync::lockCounters().counter.fetch_add(value, std::memory_order_relaxed)
+#else
+#define GC_LOCK_STATS_ADD(counter, value) ((void) 0)
+#endif
+
+/**
+ * @brief Hints processor that current thread is busy-waiting
+ */
+inline void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
 class SpinLock {
  public:
   SpinLock(std::atomic_flag & lockObject)
       : lock_object_{lockObject} {
-    while (lock_object_.test_and_set(std::memory_order_acquire));
+    while (lock_object_.test_and_set(std::memory_order_acquire)) {
+      cpuRelax();
+    }
   }
 
   ~SpinLock() {
@@ -60,6 +142,340 @@ class SpinLock {
   std::atomic_flag & lock_object_;
 };
 
+/**
+ * @brief Plain test-and-set lock, it is the way gc_object_control_block was locked before AdaptiveSpinLock
+ */
+class TasLock {
+ public:
+  TasLock() noexcept = default;
+  TasLock(const TasLock &) = delete;
+  TasLock & operator=(const TasLock &) = delete;
+
+  bool try_lock() noexcept {
+    const bool isLocked = !lock_object_.test_and_set(std::memory_order_acquire);
+    if (isLocked) {
+      GC_LOCK_STATS_ADD(acquire_count_, 1);
+    }
+    return isLocked;
+  }
+
+  void lock() noexcept {
+    if (try_lock()) {
+      return;
+    }
+    GC_LOCK_STATS_ADD(contended_count_, 1);
+    do {
+      GC_LOCK_STATS_ADD(spin_count_, 1);
+      cpuRelax();
+    } while (!try_lock());
+  }
+
+  void unlock() noexcept {
+    lock_object_.clear(std::memory_order_release);
+  }
+
+ private:
+  std::atomic_flag lock_object_ = ATOMIC_FLAG_INIT;
+};
+
+/**
+ * @brief Test-and-test-and-set lock that spins with exponential backoff for SpinRounds rounds,
+ * then yields for YieldRounds rounds and then parks thread on futex (yields on platforms without futex)
+ */
+template <unsigned SpinRounds = 8, unsigned YieldRounds = 4, unsigned MaxBackoff = 64>
+class AdaptiveSpinLock {
+  static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+                "std::atomic<std::uint32_t> should be usable as futex word !!");
+
+ public:
+  AdaptiveSpinLock() noexcept = default;
+  AdaptiveSpinLock(const AdaptiveSpinLock &) = delete;
+  AdaptiveSpinLock & operator=(const AdaptiveSpinLock &) = delete;
+
+  bool try_lock() noexcept {
+    std::uint32_t state = kUnlocked;
+    const bool isLocked = state_.compare_exchange_strong(state, kLocked, std::memory_order_acquire,
+                                                         std::memory_order_relaxed);
+    if (isLocked) {
+      GC_LOCK_STATS_ADD(acquire_count_, 1);
+    }
+    return isLocked;
+  }
+
+  void lock() noexcept {
+    if (!try_lock()) {
+      lockContended();
+    }
+  }
+
+  void unlock() noexcept {
+    if (state_.exchange(kUnlocked, std::memory_order_release) == kLockedWithWaiters) {
+      wakeOne();
+    }
+  }
+
+ private:
+  static constexpr std::uint32_t kUnlocked = 0;
+  static constexpr std::uint32_t kLocked = 1;
+  static constexpr std::uint32_t kLockedWithWaiters = 2;
+
+  bool tryLockAfterTest() noexcept {
+    return state_.load(std::memory_order_relaxed) == kUnlocked && try_lock();
+  }
+
+  void lockContended() noexcept {
+    GC_LOCK_STATS_ADD(contended_count_, 1);
+    unsigned backoff = 1;
+    for (unsigned round = 0; round < SpinRounds; ++round) {
+      for (unsigned i = 0; i < backoff; ++i) {
+        cpuRelax();
+      }
+      GC_LOCK_STATS_ADD(spin_count_, backoff);
+      if (tryLockAfterTest()) {
+        return;
+      }
+      backoff = std::min(backoff * 2, MaxBackoff);
+    }
+    for (unsigned round = 0; round < YieldRounds; ++round) {
+      GC_LOCK_STATS_ADD(yield_count_, 1);
+      std::this_thread::yield();
+      if (tryLockAfterTest()) {
+        return;
+      }
+    }
+    // NOTE(redra): Holder is likely preempted, mark lock as having waiters so that unlock wakes us up
+    while (state_.exchange(kLockedWithWaiters, std::memory_order_acquire) != kUnlocked) {
+      GC_LOCK_STATS_ADD(park_count_, 1);
+      waitWhileLocked();
+    }
+    GC_LOCK_STATS_ADD(acquire_count_, 1);
+  }
+
+  void waitWhileLocked() noexcept {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&state_), FUTEX_WAIT_PRIVATE,
+            kLockedWithWaiters, nullptr, nullptr, 0);
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  void wakeOne() noexcept {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+  }
+
+  std::atomic<std::uint32_t> state_{kUnlocked};
+};
+
+}
+
+#ifndef GC_LOCK_TYPE
+#define GC_LOCK_TYPE memory::sync::AdaptiveSpinLock<>
+#endif
+
+/**
+ * @brief Lock guarding root table of gc_object_control_block. Could be replaced for the whole program by GC_LOCK_TYPE,
+ * it should provide lock(), try_lock() and unlock()
+ */
+using gc_lock_type = GC_LOCK_TYPE;
+
+/**
+ * @brief Snapshot of runtime counters, collected only when GC_ENABLE_STATS is defined
+ */
+struct gc_stats {
+  // NOTE(redra): Objects created before reset_stats() and destroyed after it make it negative
+  std::int64_t live_objects_ = 0;
+  std::uint64_t created_objects_ = 0;
+  std::uint64_t destroyed_objects_ = 0;
+  // NOTE(redra): Control blocks allocated separately from object, i.e. for adopted raw pointers
+  std::uint64_t control_block_allocations_ = 0;
+  std::uint64_t connect_calls_ = 0;
+  std::uint64_t disconnect_calls_ = 0;
+  // NOTE(redra): Propagation is one root update started by gc_ptr, its tasks are objects it visited
+  std::uint64_t propagations_ = 0;
+  std::uint64_t propagation_tasks_ = 0;
+  std::uint64_t cycle_collections_ = 0;
+  std::uint64_t cycle_reclaimed_objects_ = 0;
+  gc_lock_stats lock_stats_;
+
+  double averagePropagationDepth() const noexcept {
+    return propagations_ == 0 ? 0.0 : static_cast<double>(propagation_tasks_) / propagations_;
+  }
+
+  double averageCycleReclaimedObjects() const noexcept {
+    return cycle_collections_ == 0 ? 0.0 : static_cast<double>(cycle_reclaimed_objects_) / cycle_collections_;
+  }
+};
+
+/**
+ * @brief Counters of one thread. They are written only by owner thread, so increment is relaxed load and store
+ * and snapshot could be taken from other thread at any time
+ */
+struct gc_stats_counters {
+  std::atomic<std::uint64_t> created_objects_{0};
+  std::atomic<std::uint64_t> destroyed_objects_{0};
+  std::atomic<std::uint64_t> control_block_allocations_{0};
+  std::atomic<std::uint64_t> connect_calls_{0};
+  std::atomic<std::uint64_t> disconnect_calls_{0};
+  std::atomic<std::uint64_t> propagations_{0};
+  std::atomic<std::uint64_t> propagation_tasks_{0};
+  std::atomic<std::uint64_t> cycle_collections_{0};
+  std::atomic<std::uint64_t> cycle_reclaimed_objects_{0};
+
+  static void add(std::atomic<std::uint64_t> & counter, const std::uint64_t value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  void addTo(gc_stats & stats) const noexcept {
+    stats.created_objects_ += created_objects_.load(std::memory_order_relaxed);
+    stats.destroyed_objects_ += destroyed_objects_.load(std::memory_order_relaxed);
+    stats.control_block_allocations_ += control_block_allocations_.load(std::memory_order_relaxed);
+    stats.connect_calls_ += connect_calls_.load(std::memory_order_relaxed);
+    stats.disconnect_calls_ += disconnect_calls_.load(std::memory_order_relaxed);
+    stats.propagations_ += propagations_.load(std::memory_order_relaxed);
+    stats.propagation_tasks_ += propagation_tasks_.load(std::memory_order_relaxed);
+    stats.cycle_collections_ += cycle_collections_.load(std::memory_order_relaxed);
+    stats.cycle_reclaimed_objects_ += cycle_reclaimed_objects_.load(std::memory_order_relaxed);
+  }
+
+  void reset() noexcept {
+    created_objects_.store(0, std::memory_order_relaxed);
+    destroyed_objects_.store(0, std::memory_order_relaxed);
+    control_block_allocations_.store(0, std::memory_order_relaxed);
+    connect_calls_.store(0, std::memory_order_relaxed);
+    disconnect_calls_.store(0, std::memory_order_relaxed);
+    propagations_.store(0, std::memory_order_relaxed);
+    propagation_tasks_.store(0, std::memory_order_relaxed);
+    cycle_collections_.store(0, std::memory_order_relaxed);
+    cycle_reclaimed_objects_.store(0, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief Registry of counters of all threads. Counters of exited thread are added to retired counters
+ */
+class gc_stats_registry {
+ public:
+  static gc_stats_counters & threadCounters() {
+    static thread_local gc_thread_registration registration;
+    return registration.counters_;
+  }
+
+  static gc_stats snapshot() {
+    auto & state = getState();
+    gc_stats stats;
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.retired_counters_.addTo(stats);
+    for (auto countersPtr : state.threads_counters_) {
+      countersPtr->addTo(stats);
+    }
+    stats.live_objects_ = static_cast<std::int64_t>(stats.created_objects_ - stats.destroyed_objects_);
+    return stats;
+  }
+
+  // NOTE(redra): Counters of other threads are reset by relaxed stores, increment that races with reset is lost
+  static void reset() {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.retired_counters_.reset();
+    for (auto countersPtr : state.threads_counters_) {
+      countersPtr->reset();
+    }
+  }
+
+ private:
+  struct gc_stats_state {
+    std::mutex mutex_;
+    std::vector<gc_stats_counters *> threads_counters_;
+    gc_stats_counters retired_counters_;
+  };
+
+  struct gc_thread_registration {
+    gc_stats_counters counters_;
+
+    gc_thread_registration() {
+      auto & state = getState();
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      state.threads_counters_.push_back(&counters_);
+    }
+
+    ~gc_thread_registration() {
+      auto & state = getState();
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      gc_stats retiredStats;
+      counters_.addTo(retiredStats);
+      gc_stats_counters::add(state.retired_counters_.created_objects_, retiredStats.created_objects_);
+      gc_stats_counters::add(state.retired_counters_.destroyed_objects_, retiredStats.destroyed_objects_);
+      gc_stats_counters::add(state.retired_counters_.control_block_allocations_,
+                             retiredStats.control_block_allocations_);
+      gc_stats_counters::add(state.retired_counters_.connect_calls_, retiredStats.connect_calls_);
+      gc_stats_counters::add(state.retired_counters_.disconnect_calls_, retiredStats.disconnect_calls_);
+      gc_stats_counters::add(state.retired_counters_.propagations_, retiredStats.propagations_);
+      gc_stats_counters::add(state.retired_counters_.propagation_tasks_, retiredStats.propagation_tasks_);
+      gc_stats_counters::add(state.retired_counters_.cycle_collections_, retiredStats.cycle_collections_);
+      gc_stats_counters::add(state.retired_counters_.cycle_reclaimed_objects_,
+                             retiredStats.cycle_reclaimed_objects_);
+      state.threads_counters_.erase(
+          std::find(state.threads_counters_.begin(), state.threads_counters_.end(), &counters_));
+    }
+  };
+
+  // NOTE(redra): State is never destroyed, so threads that exit after static destruction still could retire
+  static gc_stats_state & getState() {
+    static auto statePtr = new gc_stats_state{};
+    return *statePtr;
+  }
+};
+
+#ifdef GC_ENABLE_STATS
+#define GC_STATS_ADD(counter, value) \
+  memory::gc_stats_counters::add(memory::gc_stats_registry::threadCounters().counter, value)
+#else
+#define GC_STATS_ADD(counter, value) ((void) 0)
+#endif
+
+namespace gc {
+
+/**
+ * @brief Returns lock counters collected since start of program or last reset_lock_stats() call
+ */
+inline gc_lock_stats lock_stats() {
+  auto & lockCounters = sync::lockCounters();
+  gc_lock_stats lockStats;
+  lockStats.acquire_count_ = lockCounters.acquire_count_.load(std::memory_order_relaxed);
+  lockStats.contended_count_ = lockCounters.contended_count_.load(std::memory_order_relaxed);
+  lockStats.spin_count_ = lockCounters.spin_count_.load(std::memory_order_relaxed);
+  lockStats.yield_count_ = lockCounters.yield_count_.load(std::memory_order_relaxed);
+  lockStats.park_count_ = lockCounters.park_count_.load(std::memory_order_relaxed);
+  return lockStats;
+}
+
+inline void reset_lock_stats() {
+  auto & lockCounters = sync::lockCounters();
+  lockCounters.acquire_count_.store(0, std::memory_order_relaxed);
+  lockCounters.contended_count_.store(0, std::memory_order_relaxed);
+  lockCounters.spin_count_.store(0, std::memory_order_relaxed);
+  lockCounters.yield_count_.store(0, std::memory_order_relaxed);
+  lockCounters.park_count_.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns sum of runtime counters of all threads collected since start of program
+ * or last reset_stats() call, together with lock counters
+ */
+inline gc_stats stats() {
+  gc_stats stats = gc_stats_registry::snapshot();
+  stats.lock_stats_ = lock_stats();
+  return stats;
+}
+
+inline void reset_stats() {
+  gc_stats_registry::reset();
+  reset_lock_stats();
+}
+
 }
 
 template <typename T>
@@ -68,10 +484,10 @@ class has_use_gc_ptr
   typedef char one;
   struct two { char x[2]; };
 
-  template <typename C> static one testConnectToRoot( typeof(&C::connectToRoot) ) ;
+  template <typename C> static one testConnectToRoot( decltype(&C::connectToRoot) ) ;
   template <typename C> static two testConnectToRoot(...);
 
-  template <typename C> static one testDisconnectFromRoot( typeof(&C::disconnectFromRoot) ) ;
+  template <typename C> static one testDisconnectFromRoot( decltype(&C::disconnectFromRoot) ) ;
   template <typename C> static two testDisconnectFromRoot(...);
 
  public:
@@ -79,230 +495,4208 @@ class has_use_gc_ptr
                  sizeof(testDisconnectFromRoot<T>(0)) == sizeof(char)};
 };
 
-struct gc_object_control_block {
-  const bool is_aligned_memory_ = false;
-  std::atomic_flag lock_object_ = ATOMIC_FLAG_INIT;
-  std::unordered_map<const void *, uint32_t> root_ptrs_;
-};
+using gc_root_id = std::uint32_t;
 
-template <typename TObject>
-struct gc_object_aligned_storage {
-  TObject object_;
-  gc_object_control_block control_block_;
-};
+/**
+ * @brief Hands out dense 32-bit root identities that are not bound to address of gc_ptr,
+ * so identity could be handed over to another gc_ptr on move. Identity released by thread is reused by it
+ * only after removal of root is propagated and no batch is recorded, identities that thread does not need
+ * are handed over to other threads in blocks
+ */
+class gc_root_registry {
+ public:
+  static constexpr std::size_t kBlockSize = 1024;
 
-template <typename TBase, typename TDerived>
-inline void call_ConnectBaseToRoot(TDerived * derivedPtr, const void * rootPtr) {
-  if constexpr (memory::has_use_gc_ptr<TBase>::value) {
-    derivedPtr->TBase::connectToRoot(rootPtr);
+  static const void * toRootPtr(const gc_root_id rootId) noexcept {
+    return reinterpret_cast<const void *>(static_cast<std::uintptr_t>(rootId));
   }
-}
 
-template <typename TExact, typename TDeduced>
-inline void call_ConnectFieldToRoot(TDeduced & t, const void * rootPtr) {
-  if constexpr (!std::is_pointer<TExact>::value &&
-                !std::is_reference<TExact>::value &&
-                memory::has_use_gc_ptr<TExact>::value) {
-    t.connectToRoot(rootPtr);
+  static gc_root_id toRootId(const void * const rootPtr) noexcept {
+    return static_cast<gc_root_id>(reinterpret_cast<std::uintptr_t>(rootPtr));
   }
-}
 
-template <typename TBase, typename TDerived>
-inline void call_DisconnectBaseFromRoot(TDerived * derivedPtr, const bool isRoot, const void * rootPtr) {
-  if constexpr (memory::has_use_gc_ptr<TBase>::value) {
-    derivedPtr->TBase::disconnectFromRoot(isRoot, rootPtr);
+  static gc_root_id acquire() {
+    if (is_thread_cache_destroyed_) {
+      std::vector<gc_root_id> rootIds;
+      takeBlock(rootIds);
+      const gc_root_id rootId = rootIds.back();
+      rootIds.pop_back();
+      giveBlock(rootIds);
+      return rootId;
+    }
+    auto & freeRootIds = getThreadCache().free_root_ids_;
+    if (freeRootIds.empty()) {
+      takeBlock(freeRootIds);
+    }
+    const gc_root_id rootId = freeRootIds.back();
+    freeRootIds.pop_back();
+    return rootId;
   }
-}
 
-template <typename TExact, typename TDeduced>
-inline void call_DisconnectFieldFromRoot(TDeduced & t, const bool isRoot, const void * rootPtr) {
-  if constexpr (!std::is_pointer<TExact>::value &&
-                !std::is_reference<TExact>::value &&
-                memory::has_use_gc_ptr<TExact>::value) {
-    t.disconnectFromRoot(isRoot, rootPtr);
+  /**
+   * @brief Defined after gc_propagation_worklist, because identity could still be in worklist or batch log
+   */
+  static void release(gc_root_id rootId);
+
+  /**
+   * @brief Makes identities released during propagation available again, called when worklist of thread is idle
+   */
+  static void recycle() {
+    if (is_thread_cache_destroyed_) {
+      return;
+    }
+    auto & threadCache = getThreadCache();
+    if (threadCache.pending_root_ids_.empty()) {
+      return;
+    }
+    threadCache.free_root_ids_.insert(threadCache.free_root_ids_.end(),
+                                      threadCache.pending_root_ids_.begin(), threadCache.pending_root_ids_.end());
+    threadCache.pending_root_ids_.clear();
+    trim(threadCache.free_root_ids_);
   }
-}
 
-template <typename TObject>
-class gc_ptr {
-  static_assert(!std::is_pointer<TObject>::value, "TObject should not be pointer type !!");
-  static_assert(!std::is_reference<TObject>::value, "TObject should not be reference type !!");
+ private:
+  struct thread_cache {
+    std::vector<gc_root_id> free_root_ids_;
+    std::vector<gc_root_id> pending_root_ids_;
 
- public:
-  gc_ptr()
-    : root_ptrs_{this} {
-    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
+    ~thread_cache() {
+      free_root_ids_.insert(free_root_ids_.end(), pending_root_ids_.begin(), pending_root_ids_.end());
+      giveBlock(free_root_ids_);
+      // NOTE(redra): Roots destroyed by later thread_local destructors give identities to global blocks
+      is_thread_cache_destroyed_ = true;
+    }
+  };
+
+  struct registry_state {
+    std::mutex mutex_;
+    std::vector<std::vector<gc_root_id>> free_blocks_;
+    std::uint64_t next_root_id_ = 1;
+  };
+
+  static registry_state & getState() {
+    static registry_state state;
+    return state;
   }
 
-  explicit gc_ptr(TObject * objectPtr)
-    : root_ptrs_{this} {
-    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
-    object_ptr_ = objectPtr;
-    object_control_block_ptr_ = new gc_object_control_block{};
-    for (auto & rootRefPtr : this->root_ptrs_) {
-      addRootPtrToObject(rootRefPtr);
+  static thread_cache & getThreadCache() {
+    static thread_local thread_cache threadCache;
+    return threadCache;
+  }
+
+  /**
+   * @brief Takes block released by other threads or block of never used identities
+   */
+  static void takeBlock(std::vector<gc_root_id> & rootIds) {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    if (!state.free_blocks_.empty()) {
+      rootIds.swap(state.free_blocks_.back());
+      state.free_blocks_.pop_back();
+      return;
+    }
+    if (state.next_root_id_ + kBlockSize > std::uint64_t{std::numeric_limits<gc_root_id>::max()} + 1) {
+      throw std::length_error{"All root identities are in use"};
     }
+    for (std::size_t i = kBlockSize; i > 0; --i) {
+      rootIds.push_back(static_cast<gc_root_id>(state.next_root_id_ + i - 1));
+    }
+    state.next_root_id_ += kBlockSize;
   }
 
-  gc_ptr(const gc_ptr & gcPtr)
-    : root_ptrs_{this} {
-    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
-    this->operator=(gcPtr);
+  static void giveBlock(std::vector<gc_root_id> & rootIds) {
+    if (rootIds.empty()) {
+      return;
+    }
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.free_blocks_.emplace_back();
+    state.free_blocks_.back().swap(rootIds);
   }
 
-  ~gc_ptr() {
-    removeAllRoots();
+  /**
+   * @brief Keeps at most two blocks of free identities on thread
+   */
+  static void trim(std::vector<gc_root_id> & freeRootIds) {
+    if (freeRootIds.size() <= 2 * kBlockSize) {
+      return;
+    }
+    std::vector<gc_root_id> rootIds(freeRootIds.end() - kBlockSize, freeRootIds.end());
+    freeRootIds.resize(freeRootIds.size() - kBlockSize);
+    giveBlock(rootIds);
   }
 
-  template <typename T, typename ... TArgs>
-  friend gc_ptr<T> make_gc(TArgs && ... args);
+  static thread_local bool is_thread_cache_destroyed_;
+};
 
-  explicit operator bool() const noexcept {
-    return object_ptr_ != nullptr;
+inline thread_local bool gc_root_registry::is_thread_cache_destroyed_ = false;
+
+/**
+ * @brief Generates unique root identity, see gc_root_registry
+ */
+inline const void * make_root_ptr() {
+  return gc_root_registry::toRootPtr(gc_root_registry::acquire());
+}
+
+/**
+ * @brief Returns root identity made by make_root_ptr() when root is destroyed
+ */
+inline void release_root_ptr(const void * const rootPtr) {
+  gc_root_registry::release(gc_root_registry::toRootId(rootPtr));
+}
+
+#ifndef GC_ROOT_SET_INLINE_CAPACITY
+#define GC_ROOT_SET_INLINE_CAPACITY 2
+#endif
+
+#ifndef GC_ROOT_TABLE_INLINE_CAPACITY
+#define GC_ROOT_TABLE_INLINE_CAPACITY 2
+#endif
+
+/**
+ * @brief Vector of trivially copyable values that keeps up to InlineCapacity values inside itself
+ * and spills to heap only when more values are stored
+ */
+template <typename TValue, std::size_t InlineCapacity>
+class gc_small_vector {
+  static_assert(std::is_trivially_copyable<TValue>::value, "TValue should be trivially copyable !!");
+  static_assert(InlineCapacity > 0, "InlineCapacity should be greater than zero !!");
+
+ public:
+  gc_small_vector() noexcept = default;
+
+  gc_small_vector(const gc_small_vector & smallVector) {
+    reserve(smallVector.size_);
+    std::copy(smallVector.begin(), smallVector.end(), data());
+    size_ = smallVector.size_;
   }
 
-  TObject & operator *() const {
-    return *object_ptr_;
+  gc_small_vector(gc_small_vector && smallVector) noexcept {
+    swap(smallVector);
   }
 
-  TObject * operator->() const noexcept {
-    return object_ptr_;
+  ~gc_small_vector() {
+    if (isHeap()) {
+      delete [] heap_values_;
+    }
   }
 
-  gc_ptr & operator=(TObject * const objectPtr) {
-    removeAllRoots();
-    object_ptr_ = objectPtr;
-    if (object_ptr_ != nullptr) {
-      object_control_block_ptr_ = new gc_object_control_block{};
-    } else {
-      object_control_block_ptr_ = nullptr;
+  gc_small_vector & operator=(const gc_small_vector & smallVector) {
+    if (this != &smallVector) {
+      gc_small_vector{smallVector}.swap(*this);
     }
-    addAllRoots();
     return *this;
   }
 
-  gc_ptr & operator=(const gc_ptr & objectPtr) {
-    removeAllRoots();
-    object_ptr_ = objectPtr.object_ptr_;
-    object_control_block_ptr_ = objectPtr.object_control_block_ptr_;
-    addAllRoots();
+  gc_small_vector & operator=(gc_small_vector && smallVector) noexcept {
+    gc_small_vector{std::move(smallVector)}.swap(*this);
     return *this;
   }
 
-  void connectToRoot(const void * rootPtr) const {
-    root_ptrs_.insert(rootPtr);
-    addRootPtrToObject(rootPtr);
-    if (is_root_) {
-      is_root_ = false;
-      disconnectFromRoot(true, this);
-    }
+  TValue * begin() noexcept {
+    return data();
   }
 
-  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
-    root_ptrs_.erase(rootPtr);
-    removeRootPtrFromObject(isRoot, rootPtr);
+  TValue * end() noexcept {
+    return data() + size_;
   }
 
- protected:
-  void addAllRoots() {
-    if (object_control_block_ptr_ != nullptr) {
-      auto rootPtrs = root_ptrs_;
-      for (auto &rootRefPtr : rootPtrs) {
-        addRootPtrToObject(rootRefPtr);
-      }
-    }
+  const TValue * begin() const noexcept {
+    return data();
   }
 
-  void removeAllRoots() {
-    if (object_control_block_ptr_ != nullptr) {
-      auto rootPtrs = root_ptrs_;
-      for (auto &rootRefPtr : rootPtrs) {
-        root_ptrs_.erase(rootRefPtr);
-        removeRootPtrFromObject(is_root_, rootRefPtr);
-      }
+  const TValue * end() const noexcept {
+    return data() + size_;
+  }
+
+  std::size_t size() const noexcept {
+    return size_;
+  }
+
+  bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+  void insert(TValue * const position, const TValue & value) {
+    auto index = static_cast<std::size_t>(position - data());
+    if (size_ == capacity_) {
+      reserve(capacity_ * 2);
     }
+    TValue * values = data();
+    std::copy_backward(values + index, values + size_, values + size_ + 1);
+    values[index] = value;
+    ++size_;
   }
 
-  void addRootPtrToObject(const void *rootPtr) const {
-    if (object_control_block_ptr_ != nullptr) {
-      bool isNewRoot;
-      {
-        sync::SpinLock lock{object_control_block_ptr_->lock_object_};
-        isNewRoot = object_control_block_ptr_->root_ptrs_.count(rootPtr) == 0;
-        if (isNewRoot) {
-          object_control_block_ptr_->root_ptrs_[rootPtr] = 1;
-        } else {
-          object_control_block_ptr_->root_ptrs_[rootPtr] += 1;
-        }
-      }
-      if (isNewRoot) {
-        if constexpr (has_use_gc_ptr<TObject>::value) {
-          object_ptr_->connectToRoot(rootPtr);
-        }
-      }
+  void erase(TValue * const position) noexcept {
+    TValue * values = data();
+    std::copy(position + 1, values + size_, position);
+    --size_;
+    if (isHeap() && size_ <= InlineCapacity) {
+      TValue * heapValues = heap_values_;
+      std::copy(heapValues, heapValues + size_, inline_values_);
+      delete [] heapValues;
+      capacity_ = InlineCapacity;
     }
   }
 
-  void removeRootPtrFromObject(const bool isRoot, const void *rootPtr) const {
-    if (object_control_block_ptr_ != nullptr) {
-      bool isRemovedRoot = false;
-      bool isNoRoots;
-      {
-        sync::SpinLock lock{object_control_block_ptr_->lock_object_};
-        if (isRoot) {
-          if (object_control_block_ptr_->root_ptrs_.count(rootPtr) > 0) {
-            object_control_block_ptr_->root_ptrs_.erase(rootPtr);
-            isRemovedRoot = true;
-          }
-        } else if (object_control_block_ptr_->root_ptrs_.count(rootPtr) > 0) {
-          object_control_block_ptr_->root_ptrs_[rootPtr] -= 1;
-          if (object_control_block_ptr_->root_ptrs_[rootPtr] == 0) {
-            object_control_block_ptr_->root_ptrs_.erase(rootPtr);
-            isRemovedRoot = true;
-          }
+  void swap(gc_small_vector & smallVector) noexcept {
+    std::swap(size_, smallVector.size_);
+    std::swap(capacity_, smallVector.capacity_);
+    std::swap(storage_, smallVector.storage_);
+  }
+
+ private:
+  bool isHeap() const noexcept {
+    return capacity_ > InlineCapacity;
+  }
+
+  TValue * data() noexcept {
+    return isHeap() ? heap_values_ : inline_values_;
+  }
+
+  const TValue * data() const noexcept {
+    return isHeap() ? heap_values_ : inline_values_;
+  }
+
+  void reserve(const std::size_t capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    auto heapValues = new TValue[capacity];
+    std::copy(begin(), end(), heapValues);
+    if (isHeap()) {
+      delete [] heap_values_;
+    }
+    heap_values_ = heapValues;
+    capacity_ = static_cast<std::uint32_t>(capacity);
+  }
+
+  std::uint32_t size_ = 0;
+  std::uint32_t capacity_ = InlineCapacity;
+  union {
+    TValue inline_values_[InlineCapacity] = {};
+    TValue * heap_values_;
+    struct {
+      unsigned char bytes_[sizeof(TValue[InlineCapacity])];
+    } storage_;
+  };
+};
+
+/**
+ * @brief Sorted set of root identities of gc_ptr, kept as 32-bit ids and handed out as root pointers
+ */
+template <std::size_t InlineCapacity = GC_ROOT_SET_INLINE_CAPACITY>
+class gc_root_set {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const void *;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = value_type;
+
+    explicit iterator(const gc_root_id * rootIdPtr) noexcept
+      : root_id_ptr_{rootIdPtr} {
+    }
+
+    const void * operator*() const noexcept {
+      return gc_root_registry::toRootPtr(*root_id_ptr_);
+    }
+
+    iterator & operator++() noexcept {
+      ++root_id_ptr_;
+      return *this;
+    }
+
+    iterator operator++(int) noexcept {
+      iterator previous = *this;
+      ++root_id_ptr_;
+      return previous;
+    }
+
+    bool operator==(const iterator & rhs) const noexcept {
+      return root_id_ptr_ == rhs.root_id_ptr_;
+    }
+
+    bool operator!=(const iterator & rhs) const noexcept {
+      return root_id_ptr_ != rhs.root_id_ptr_;
+    }
+
+   private:
+    const gc_root_id * root_id_ptr_;
+  };
+
+  gc_root_set() noexcept = default;
+
+  explicit gc_root_set(const void * rootPtr) {
+    root_ids_.insert(root_ids_.begin(), gc_root_registry::toRootId(rootPtr));
+  }
+
+  iterator begin() const noexcept {
+    return iterator{root_ids_.begin()};
+  }
+
+  iterator end() const noexcept {
+    return iterator{root_ids_.end()};
+  }
+
+  std::size_t size() const noexcept {
+    return root_ids_.size();
+  }
+
+  bool empty() const noexcept {
+    return root_ids_.empty();
+  }
+
+  std::size_t count(const void * rootPtr) const noexcept {
+    const gc_root_id rootId = gc_root_registry::toRootId(rootPtr);
+    const auto position = std::lower_bound(root_ids_.begin(), root_ids_.end(), rootId);
+    return position != root_ids_.end() && *position == rootId ? 1 : 0;
+  }
+
+  /**
+   * @return true if root was not in set
+   */
+  bool insert(const void * rootPtr) {
+    const gc_root_id rootId = gc_root_registry::toRootId(rootPtr);
+    const auto position = std::lower_bound(root_ids_.begin(), root_ids_.end(), rootId);
+    if (position != root_ids_.end() && *position == rootId) {
+      return false;
+    }
+    root_ids_.insert(position, rootId);
+    return true;
+  }
+
+  /**
+   * @return true if root was in set
+   */
+  bool erase(const void * rootPtr) noexcept {
+    const gc_root_id rootId = gc_root_registry::toRootId(rootPtr);
+    const auto position = std::lower_bound(root_ids_.begin(), root_ids_.end(), rootId);
+    if (position == root_ids_.end() || *position != rootId) {
+      return false;
+    }
+    root_ids_.erase(position);
+    return true;
+  }
+
+  void swap(gc_root_set & rootSet) noexcept {
+    root_ids_.swap(rootSet.root_ids_);
+  }
+
+ private:
+  gc_small_vector<gc_root_id, InlineCapacity> root_ids_;
+};
+
+struct gc_root_count {
+  gc_root_id root_id_;
+  std::uint32_t count_;
+
+  const void * rootPtr() const noexcept {
+    return gc_root_registry::toRootPtr(root_id_);
+  }
+};
+
+/**
+ * @brief Sorted table of roots of object with number of gc_ptr that bring each root to object.
+ * Every operation does single binary search over 8-byte entries
+ */
+template <std::size_t InlineCapacity = GC_ROOT_TABLE_INLINE_CAPACITY>
+class gc_root_table {
+ public:
+  using iterator = const gc_root_count *;
+
+  iterator begin() const noexcept {
+    return root_counts_.begin();
+  }
+
+  iterator end() const noexcept {
+    return root_counts_.end();
+  }
+
+  std::size_t size() const noexcept {
+    return root_counts_.size();
+  }
+
+  bool empty() const noexcept {
+    return root_counts_.empty();
+  }
+
+  std::uint32_t count(const void * rootPtr) const noexcept {
+    const gc_root_id rootId = gc_root_registry::toRootId(rootPtr);
+    const auto position = find(root_counts_.begin(), root_counts_.end(), rootId);
+    return position != root_counts_.end() && position->root_id_ == rootId ? position->count_ : 0;
+  }
+
+  /**
+   * @return true if root is new for object
+   */
+  bool increment(const void * rootPtr, const std::uint32_t count = 1) {
+    const gc_root_id rootId = gc_root_registry::toRootId(rootPtr);
+    const auto position = find(root_counts_.begin(), root_counts_.end(), rootId);
+    if (position != root_counts_.end() && position->root_id_ == rootId) {
+      position->count_ += count;
+      return false;
+    }
+    root_counts_.insert(position, gc_root_count{rootId, count});
+    return true;
+  }
+
+  /**
+   * @return true if last gc_ptr that brought root to object is gone and root was removed
+   */
+  bool decrement(const void * rootPtr) noexcept {
+    const gc_root_id rootId = gc_root_registry::toRootId(rootPtr);
+    const auto position = find(root_counts_.begin(), root_counts_.end(), rootId);
+    if (position == root_counts_.end() || position->root_id_ != rootId) {
+      return false;
+    }
+    position->count_ -= 1;
+    if (position->count_ == 0) {
+      root_counts_.erase(position);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @return true if root was removed
+   */
+  bool erase(const void * rootPtr) noexcept {
+    const gc_root_id rootId = gc_root_registry::toRootId(rootPtr);
+    const auto position = find(root_counts_.begin(), root_counts_.end(), rootId);
+    if (position == root_counts_.end() || position->root_id_ != rootId) {
+      return false;
+    }
+    root_counts_.erase(position);
+    return true;
+  }
+
+ private:
+  template <typename TIterator>
+  static TIterator find(TIterator first, TIterator last, const gc_root_id rootId) noexcept {
+    return std::lower_bound(first, last, rootId, [](const gc_root_count & rootCount, const gc_root_id rootId) {
+      return rootCount.root_id_ < rootId;
+    });
+  }
+
+  gc_small_vector<gc_root_count, InlineCapacity> root_counts_;
+};
+
+/**
+ * @brief Common base of control blocks, so gc_ptr could be declared before reclamation policy of incomplete
+ * TObject is known
+ */
+struct gc_basic_control_block {};
+
+struct gc_object_control_block;
+
+/**
+ * @brief Shared state of all gc_weak_ptr to one object, allocated when first gc_weak_ptr to object is created.
+ * object_ptr_ is cleared when object becomes unreachable, control block is accessed only under lock_object_
+ */
+struct gc_weak_anchor {
+  std::atomic<void *> object_ptr_;
+  gc_object_control_block * control_block_ptr_;
+  // NOTE(redra): Reachable object holds one reference, every gc_weak_ptr holds one more
+  std::atomic<std::size_t> weak_count_{1};
+  gc_lock_type lock_object_;
+
+  gc_weak_anchor(void * const objectPtr, gc_object_control_block * const controlBlockPtr) noexcept
+    : object_ptr_{objectPtr}
+    , control_block_ptr_{controlBlockPtr} {
+  }
+
+  static void acquire(gc_weak_anchor * const anchorPtr) noexcept {
+    anchorPtr->weak_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void release(gc_weak_anchor * const anchorPtr) noexcept {
+    if (anchorPtr->weak_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete anchorPtr;
+    }
+  }
+};
+
+/**
+ * @brief Control block of object with gc_root_propagation policy.
+ * While object is reachable from single root, root and its count are kept in root_state_ word
+ * and updated without lock. Roots are moved to root_ptrs_ table guarded by lock_object_ when second distinct root
+ * appears, root_state_ is kSpilledRootState until removal leaves single root again.
+ * State changes between inline and spilled only under lock_object_, so every locked path spills first
+ */
+struct gc_object_control_block : gc_basic_control_block {
+  static constexpr std::uintptr_t kNoRootState = 0;
+  static constexpr std::uintptr_t kSpilledRootState = 1;
+  // NOTE(redra): 32-bit root id leaves lower half of 64-bit root state for count
+  static constexpr unsigned kRootCountBits = sizeof(std::uintptr_t) > sizeof(gc_root_id) ? 32 : 16;
+  static constexpr std::uintptr_t kMaxRootCount = (std::uintptr_t{1} << kRootCountBits) - 1;
+
+  void (*delete_object_)(void * objectPtr, gc_object_control_block * controlBlockPtr) = nullptr;
+  std::atomic<std::uintptr_t> root_state_{kNoRootState};
+  gc_lock_type lock_object_;
+  gc_root_table<> root_ptrs_;
+  std::atomic<gc_weak_anchor *> weak_anchor_{nullptr};
+
+  ~gc_object_control_block() {
+    expireWeakAnchor();
+  }
+
+  /**
+   * @return true if root is new for object
+   */
+  bool addRootPtr(const void * rootPtr) {
+    return addRootPtr(rootPtr, [](const gc_root_table<> *) {});
+  }
+
+  /**
+   * @param connect called only when root is new for object, with roots of object including the new one
+   * or with nullptr if object is reachable only from new root. While object is reachable from several roots
+   * it is called under lock_object_, so root sets of fields of object are updated by one thread at a time
+   * @return true if root is new for object
+   */
+  template <typename TConnect>
+  bool addRootPtr(const void * rootPtr, TConnect && connect) {
+    std::uintptr_t rootState = root_state_.load(std::memory_order_acquire);
+    while (rootState != kSpilledRootState) {
+      std::uintptr_t newRootState;
+      if (rootState == kNoRootState && isInlineRootPtr(rootPtr)) {
+        newRootState = encodeRootState(rootPtr, 1);
+      } else if (rootState != kNoRootState && decodeRootPtr(rootState) == rootPtr &&
+                 decodeRootCount(rootState) < kMaxRootCount) {
+        newRootState = rootState + 1;
+      } else {
+        break;
+      }
+      if (root_state_.compare_exchange_weak(rootState, newRootState, std::memory_order_acq_rel)) {
+        const bool isFirstRoot = rootState == kNoRootState;
+        if (isFirstRoot) {
+          connect(nullptr);
         }
-        isNoRoots = object_control_block_ptr_->root_ptrs_.empty();
+        return isFirstRoot;
+      }
+    }
+    std::lock_guard<gc_lock_type> lock{lock_object_};
+    spillRootState();
+    const bool isNewRoot = root_ptrs_.increment(rootPtr);
+    if (isNewRoot) {
+      connect(&root_ptrs_);
+    }
+    return isNewRoot;
+  }
+
+  /**
+   * @return true if root was removed from object
+   */
+  bool removeRootPtr(const bool isRoot, const void * rootPtr, bool & isNoRoots) {
+    return removeRootPtr(isRoot, rootPtr, isNoRoots, [](const gc_root_table<> *) {});
+  }
+
+  /**
+   * @param isRoot true if root is destroyed and should be removed regardless of its count
+   * @param isNoRoots set to true if object is not reachable from any root
+   * @param disconnect called when root was removed, with remaining roots of object or with nullptr if there are
+   * none, under lock_object_ while object is reachable from other roots
+   * @return true if root was removed from object
+   */
+  template <typename TDisconnect>
+  bool removeRootPtr(const bool isRoot, const void * rootPtr, bool & isNoRoots, TDisconnect && disconnect) {
+    std::uintptr_t rootState = root_state_.load(std::memory_order_acquire);
+    while (rootState != kSpilledRootState) {
+      if (rootState == kNoRootState || decodeRootPtr(rootState) != rootPtr) {
+        isNoRoots = rootState == kNoRootState;
+        return false;
       }
-      if (isRemovedRoot) {
-        if constexpr (has_use_gc_ptr<TObject>::value) {
-          object_ptr_->disconnectFromRoot(isRoot, rootPtr);
+      const std::uintptr_t newRootState =
+          isRoot || decodeRootCount(rootState) == 1 ? kNoRootState : rootState - 1;
+      if (root_state_.compare_exchange_weak(rootState, newRootState, std::memory_order_acq_rel)) {
+        isNoRoots = newRootState == kNoRootState;
+        if (isNoRoots) {
+          // NOTE(redra): Other thread could have just unspilled root state and still hold lock_object_,
+          //              so object is not reported unreachable until that thread released it
+          lock_object_.lock();
+          lock_object_.unlock();
+          disconnect(nullptr);
         }
+        return isNoRoots;
       }
-      if (isRemovedRoot && isNoRoots) {
-        if (object_control_block_ptr_->is_aligned_memory_) {
-          auto gcObjectAlignedStoragePtr = reinterpret_cast<gc_object_aligned_storage<TObject>*>(object_ptr_);
-          delete gcObjectAlignedStoragePtr;
-        } else {
-          delete object_ptr_;
-          delete object_control_block_ptr_;
+    }
+    std::lock_guard<gc_lock_type> lock{lock_object_};
+    spillRootState();
+    const bool isRemovedRoot = isRoot ? root_ptrs_.erase(rootPtr) : root_ptrs_.decrement(rootPtr);
+    isNoRoots = root_ptrs_.empty();
+    if (isRemovedRoot) {
+      disconnect(&root_ptrs_);
+      unspillRootState();
+    }
+    return isRemovedRoot;
+  }
+
+  bool hasNoRoots() {
+    const std::uintptr_t rootState = root_state_.load(std::memory_order_acquire);
+    if (rootState != kSpilledRootState) {
+      return rootState == kNoRootState;
+    }
+    std::lock_guard<gc_lock_type> lock{lock_object_};
+    spillRootState();
+    return root_ptrs_.empty();
+  }
+
+  /**
+   * @brief Copies roots of object together with number of gc_ptr that bring each of them
+   */
+  std::vector<gc_root_count> copyRootCounts() {
+    std::vector<gc_root_count> rootCounts;
+    const std::uintptr_t rootState = root_state_.load(std::memory_order_acquire);
+    if (rootState != kSpilledRootState) {
+      if (rootState != kNoRootState) {
+        rootCounts.push_back({gc_root_registry::toRootId(decodeRootPtr(rootState)), decodeRootCount(rootState)});
+      }
+      return rootCounts;
+    }
+    std::lock_guard<gc_lock_type> lock{lock_object_};
+    spillRootState();
+    rootCounts.assign(root_ptrs_.begin(), root_ptrs_.end());
+    return rootCounts;
+  }
+
+  /**
+   * @brief Adds root only while object is reachable from other roots, so unreachable object is not resurrected.
+   * connect is called under lock_object_ with roots of object when root was added.
+   * Object reachable from single root is spilled to root table only until one of two roots is removed
+   * @return true if root was added
+   */
+  template <typename TConnect>
+  bool tryAddRootPtr(const void * rootPtr, TConnect && connect) {
+    // NOTE(redra): Object without roots never gets them back, so it is not spilled
+    if (root_state_.load(std::memory_order_acquire) == kNoRootState) {
+      return false;
+    }
+    std::lock_guard<gc_lock_type> lock{lock_object_};
+    spillRootState();
+    if (root_ptrs_.empty()) {
+      return false;
+    }
+    if (root_ptrs_.increment(rootPtr)) {
+      connect(&root_ptrs_);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Returns weak anchor of object with one more reference, anchor is created by first call
+   */
+  gc_weak_anchor * acquireWeakAnchor(void * const objectPtr) {
+    gc_weak_anchor * anchorPtr = weak_anchor_.load(std::memory_order_acquire);
+    if (anchorPtr == nullptr) {
+      auto newAnchorPtr = new gc_weak_anchor{objectPtr, this};
+      if (weak_anchor_.compare_exchange_strong(anchorPtr, newAnchorPtr, std::memory_order_acq_rel)) {
+        anchorPtr = newAnchorPtr;
+      } else {
+        delete newAnchorPtr;
+      }
+    }
+    gc_weak_anchor::acquire(anchorPtr);
+    return anchorPtr;
+  }
+
+  /**
+   * @brief Called once object became unreachable, after that gc_weak_ptr to object are expired
+   */
+  void expireWeakAnchor() noexcept {
+    gc_weak_anchor * const anchorPtr = weak_anchor_.exchange(nullptr, std::memory_order_acq_rel);
+    if (anchorPtr != nullptr) {
+      {
+        std::lock_guard<gc_lock_type> lock{anchorPtr->lock_object_};
+        anchorPtr->object_ptr_.store(nullptr, std::memory_order_release);
+        anchorPtr->control_block_ptr_ = nullptr;
+      }
+      gc_weak_anchor::release(anchorPtr);
+    }
+  }
+
+ private:
+  static bool isInlineRootPtr(const void * rootPtr) noexcept {
+    return (reinterpret_cast<std::uintptr_t>(rootPtr) >> (sizeof(std::uintptr_t) * 8 - kRootCountBits)) == 0;
+  }
+
+  static std::uintptr_t encodeRootState(const void * rootPtr, const std::uintptr_t count) noexcept {
+    return (reinterpret_cast<std::uintptr_t>(rootPtr) << kRootCountBits) | count;
+  }
+
+  static const void * decodeRootPtr(const std::uintptr_t rootState) noexcept {
+    return reinterpret_cast<const void *>(rootState >> kRootCountBits);
+  }
+
+  static std::uint32_t decodeRootCount(const std::uintptr_t rootState) noexcept {
+    return static_cast<std::uint32_t>(rootState & kMaxRootCount);
+  }
+
+  /**
+   * @brief Moves inline root to root_ptrs_, called under lock_object_
+   */
+  void spillRootState() {
+    std::uintptr_t rootState = root_state_.load(std::memory_order_acquire);
+    while (rootState != kSpilledRootState) {
+      if (root_state_.compare_exchange_weak(rootState, kSpilledRootState, std::memory_order_acq_rel)) {
+        if (rootState != kNoRootState) {
+          root_ptrs_.increment(decodeRootPtr(rootState), decodeRootCount(rootState));
         }
-        object_ptr_ = nullptr;
-        object_control_block_ptr_ = nullptr;
-      } else if (root_ptrs_.empty()) {
-        object_ptr_ = nullptr;
-        object_control_block_ptr_ = nullptr;
+        break;
       }
     }
   }
 
-  mutable bool is_root_ = true;
-  mutable std::unordered_set<const void *> root_ptrs_;
-  mutable TObject * object_ptr_ = nullptr;
-  mutable gc_object_control_block * object_control_block_ptr_ = nullptr;
+  /**
+   * @brief Moves single remaining root back to root_state_ word, so following updates do not take lock_object_.
+   * Called under lock_object_, table is reset, because region drops object whose table owns nothing
+   */
+  void unspillRootState() {
+    if (root_ptrs_.size() != 1) {
+      return;
+    }
+    const gc_root_count rootCount = *root_ptrs_.begin();
+    if (!isInlineRootPtr(rootCount.rootPtr()) || rootCount.count_ > kMaxRootCount) {
+      return;
+    }
+    root_ptrs_ = gc_root_table<>{};
+    root_state_.store(encodeRootState(rootCount.rootPtr(), rootCount.count_), std::memory_order_release);
+  }
 };
 
-template <typename TObject, typename ... TArgs>
-gc_ptr<TObject> make_gc(TArgs && ... args) {
-  gc_ptr<TObject> ptr{};
-  ptr.removeAllRoots();
-  auto gcObjectAlignedStoragePtr = new gc_object_aligned_storage<TObject>{
-      {std::forward<TObject>(args)...},
-      {true, ATOMIC_FLAG_INIT, {}}
+#ifdef GC_ENABLE_HEAP_DUMP
+
+/**
+ * @brief Live object as seen by gc::heap_snapshot()
+ */
+struct gc_heap_object {
+  const void * object_ptr_;
+  std::string type_name_;
+  std::size_t size_;
+  std::vector<gc_root_count> root_counts_;
+};
+
+/**
+ * @brief Root as seen by gc::heap_snapshot(). holder_ptr_ is address of gc_ptr or gc_vector that owns root,
+ * target_ptr_ is object it points to directly (nullptr for gc_vector)
+ */
+struct gc_heap_root {
+  const void * root_ptr_;
+  const void * holder_ptr_;
+  const void * target_ptr_;
+};
+
+struct gc_heap_snapshot {
+  std::vector<gc_heap_object> objects_;
+  std::vector<gc_heap_root> roots_;
+};
+
+/**
+ * @brief Registry of live objects with gc_root_propagation policy and of roots that hold them,
+ * maintained only when GC_ENABLE_HEAP_DUMP is defined. Object is removed from registry before it is destroyed,
+ * so snapshot could read control blocks of registered objects while holding registry lock
+ */
+class gc_heap_registry {
+ public:
+  template <typename TObject>
+  static void add(const TObject * const objectPtr, gc_object_control_block * const controlBlockPtr) {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.objects_[controlBlockPtr] = {objectPtr, &typeid(TObject), sizeof(TObject)};
+  }
+
+  static void remove(gc_object_control_block * const controlBlockPtr) {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.objects_.erase(controlBlockPtr);
+  }
+
+  static void addRoot(const void * const rootPtr, const void * const holderPtr, const void * const targetPtr) {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.roots_[rootPtr] = {rootPtr, holderPtr, targetPtr};
+  }
+
+  static void removeRoot(const void * const rootPtr) {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.roots_.erase(rootPtr);
+  }
+
+  static gc_heap_snapshot snapshot() {
+    auto & state = getState();
+    gc_heap_snapshot snapshot;
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    snapshot.objects_.reserve(state.objects_.size());
+    for (auto & object : state.objects_) {
+      snapshot.objects_.push_back({object.second.object_ptr_,
+                                   typeName(*object.second.type_),
+                                   object.second.size_,
+                                   object.first->copyRootCounts()});
+    }
+    snapshot.roots_.reserve(state.roots_.size());
+    for (auto & root : state.roots_) {
+      snapshot.roots_.push_back(root.second);
+    }
+    return snapshot;
+  }
+
+ private:
+  struct gc_heap_entry {
+    const void * object_ptr_;
+    const std::type_info * type_;
+    std::size_t size_;
   };
-  ptr.object_ptr_ = &gcObjectAlignedStoragePtr->object_;
-  ptr.object_control_block_ptr_ = &gcObjectAlignedStoragePtr->control_block_;
-  ptr.addAllRoots();
-}
+
+  struct gc_heap_state {
+    std::mutex mutex_;
+    std::unordered_map<gc_object_control_block *, gc_heap_entry> objects_;
+    std::unordered_map<const void *, gc_heap_root> roots_;
+  };
+
+  static std::string typeName(const std::type_info & type) {
+#if __has_include(<cxxabi.h>)
+    int status = 0;
+    char * const demangledName = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    if (status == 0 && demangledName != nullptr) {
+      std::string name{demangledName};
+      std::free(demangledName);
+      return name;
+    }
+#endif
+    return type.name();
+  }
+
+  static gc_heap_state & getState() {
+    static auto statePtr = new gc_heap_state{};
+    return *statePtr;
+  }
+};
+
+#define GC_HEAP_REGISTER(objectPtr, controlBlockPtr) memory::gc_heap_registry::add(objectPtr, controlBlockPtr)
+#define GC_HEAP_UNREGISTER(controlBlockPtr) memory::gc_heap_registry::remove(controlBlockPtr)
+#define GC_HEAP_REGISTER_ROOT(rootPtr, holderPtr, targetPtr) \
+  memory::gc_heap_registry::addRoot(rootPtr, holderPtr, targetPtr)
+#define GC_HEAP_UNREGISTER_ROOT(rootPtr) memory::gc_heap_registry::removeRoot(rootPtr)
+#else
+#define GC_HEAP_REGISTER(objectPtr, controlBlockPtr) ((void) 0)
+#define GC_HEAP_UNREGISTER(controlBlockPtr) ((void) 0)
+#define GC_HEAP_REGISTER_ROOT(rootPtr, holderPtr, targetPtr) ((void) 0)
+#define GC_HEAP_UNREGISTER_ROOT(rootPtr) ((void) 0)
+#endif
+
+/**
+ * @brief Reclamation policy that propagates roots through object graph, so every object knows all roots it is
+ * reachable from, and destroys object exactly when last root is gone. Edge update costs O(reachable subgraph)
+ */
+struct gc_root_propagation {};
+
+/**
+ * @brief Reclamation policy that counts references and collects garbage cycles synchronously by trial deletion
+ * (Bacon-Rajan). Edge update costs O(1), object that is not part of cycle is destroyed exactly when last gc_ptr
+ * to it is gone, cycles are destroyed by memory::gc::collect_cycles() or when GC_CYCLE_COLLECTION_THRESHOLD
+ * possible cycle roots are buffered by one thread. Every thread buffers possible cycle roots of its own decrements
+ * and collects only them automatically.
+ * NOTE: Collection expects that object graph reachable from collected possible roots is not mutated
+ * by other threads at the same time.
+ * Objects of this policy do not propagate roots, so gc_ptr of root propagation policy that is stored inside
+ * them behaves as root and cycles that go through objects of both policies are not collected
+ */
+struct gc_cycle_collection {};
+
+#ifndef GC_DEFAULT_RECLAMATION_POLICY
+#define GC_DEFAULT_RECLAMATION_POLICY memory::gc_root_propagation
+#endif
+
+#ifndef GC_CYCLE_COLLECTION_THRESHOLD
+#define GC_CYCLE_COLLECTION_THRESHOLD 256
+#endif
+
+/**
+ * @brief Reclamation policy of TObject. Could be selected for the whole program by GC_DEFAULT_RECLAMATION_POLICY,
+ * for class by member type gc_reclamation_policy or by specialization of this template
+ */
+template <typename TObject, typename = void>
+struct gc_reclamation_policy {
+  using type = GC_DEFAULT_RECLAMATION_POLICY;
+};
+
+template <typename TObject>
+struct gc_reclamation_policy<TObject, std::void_t<typename TObject::gc_reclamation_policy>> {
+  using type = typename TObject::gc_reclamation_policy;
+};
+
+template <typename TObject>
+struct is_cycle_collected
+    : std::is_same<typename gc_reclamation_policy<TObject>::type, gc_cycle_collection> {};
+
+enum class gc_cycle_color : std::uint8_t {
+  black,
+  gray,
+  white,
+  purple,
+};
+
+struct gc_cycle_buffer;
+
+struct gc_cycle_control_block : gc_basic_control_block {
+  std::atomic<std::uint32_t> strong_count_{0};
+  std::atomic<gc_cycle_color> color_{gc_cycle_color::black};
+  // NOTE(redra): Buffer of possible cycle roots that holds object, buffer_index_ is guarded by its mutex
+  std::atomic<gc_cycle_buffer *> buffer_ptr_{nullptr};
+  std::size_t buffer_index_ = 0;
+  void * object_ptr_ = nullptr;
+  void (*trace_object_)(const void * objectPtr) = nullptr;
+  void (*delete_object_)(gc_cycle_control_block * controlBlockPtr) = nullptr;
+};
+
+template <typename TPolicy>
+using gc_policy_control_block_type = typename std::conditional<std::is_same<TPolicy, gc_cycle_collection>::value,
+                                                               gc_cycle_control_block,
+                                                               gc_object_control_block>::type;
+
+template <typename TObject>
+using gc_control_block_type = gc_policy_control_block_type<typename gc_reclamation_policy<TObject>::type>;
+
+/**
+ * @brief Public base class that embeds control block into object, so raw pointer to object is adopted by gc_ptr
+ * without allocation of separate control block and make_gc() allocates object alone.
+ * Base also selects reclamation policy of class. Control block is not copied together with object
+ */
+template <typename TPolicy = GC_DEFAULT_RECLAMATION_POLICY>
+class gc_enable {
+ public:
+  using gc_reclamation_policy = TPolicy;
+
+  gc_enable() noexcept = default;
+
+  gc_enable(const gc_enable &) noexcept {
+  }
+
+  gc_enable & operator=(const gc_enable &) noexcept {
+    return *this;
+  }
+
+ private:
+  template <typename T>
+  friend class gc_ptr;
+
+  mutable gc_policy_control_block_type<TPolicy> gc_control_block_;
+};
+
+template <typename TObject>
+struct is_gc_enabled
+    : std::is_base_of<gc_enable<typename gc_reclamation_policy<TObject>::type>, TObject> {};
+
+/**
+ * @brief Storage layout that places control block right after object, so object and control block share
+ * cache line and storage is as small as possible
+ */
+struct gc_compact_layout {};
+
+/**
+ * @brief Storage layout that places control block first and object on its own cache line, so updates
+ * of roots and lock of control block from other threads do not invalidate reads of object fields
+ */
+struct gc_padded_layout {};
+
+#ifndef GC_DEFAULT_STORAGE_LAYOUT
+#define GC_DEFAULT_STORAGE_LAYOUT memory::gc_compact_layout
+#endif
+
+// NOTE(redra): std::hardware_destructive_interference_size is not used, because it could differ between
+// translation units compiled with different flags and change layout of storage
+#ifndef GC_CACHE_LINE_SIZE
+#define GC_CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * @brief Storage layout of object created by make_gc() or allocate_gc(). Could be selected for the whole program
+ * by GC_DEFAULT_STORAGE_LAYOUT, for class by member type gc_storage_layout or by specialization of this template.
+ * Objects derived from gc_enable keep control block inside of object and ignore it
+ */
+template <typename TObject, typename = void>
+struct gc_storage_layout {
+  using type = GC_DEFAULT_STORAGE_LAYOUT;
+};
+
+template <typename TObject>
+struct gc_storage_layout<TObject, std::void_t<typename TObject::gc_storage_layout>> {
+  using type = typename TObject::gc_storage_layout;
+};
+
+/**
+ * @brief Creates object by constructor when it has matching one and by aggregate initialization otherwise.
+ * Returned prvalue initializes member of storage in place, so object is neither copied nor moved
+ */
+template <typename TObject, typename ... TArgs>
+TObject gc_construct_object(TArgs && ... args) {
+  if constexpr (std::is_constructible<TObject, TArgs && ...>::value) {
+    return TObject(std::forward<TArgs>(args)...);
+  } else {
+    return TObject{std::forward<TArgs>(args)...};
+  }
+}
+
+template <typename TObject>
+struct gc_object_aligned_storage {
+  static constexpr bool kIsControlBlockFirst = false;
+
+  template <typename ... TArgs>
+  explicit gc_object_aligned_storage(std::in_place_t, TArgs && ... args)
+    : object_(gc_construct_object<TObject>(std::forward<TArgs>(args)...)) {
+  }
+
+  TObject object_;
+  gc_control_block_type<TObject> control_block_;
+};
+
+template <typename TObject>
+struct gc_object_padded_storage {
+  static constexpr bool kIsControlBlockFirst = true;
+
+  template <typename ... TArgs>
+  explicit gc_object_padded_storage(std::in_place_t, TArgs && ... args)
+    : object_(gc_construct_object<TObject>(std::forward<TArgs>(args)...)) {
+  }
+
+  alignas(GC_CACHE_LINE_SIZE) gc_control_block_type<TObject> control_block_;
+  alignas(GC_CACHE_LINE_SIZE) TObject object_;
+};
+
+template <typename TObject>
+using gc_object_storage_type =
+    typename std::conditional<std::is_same<typename gc_storage_layout<TObject>::type, gc_padded_layout>::value,
+                              gc_object_padded_storage<TObject>,
+                              gc_object_aligned_storage<TObject>>::type;
+
+/**
+ * @brief Storage of object derived from gc_enable, control block is already inside of object
+ */
+template <typename TObject>
+struct gc_object_intrusive_storage {
+  static constexpr bool kIsControlBlockFirst = false;
+
+  template <typename ... TArgs>
+  explicit gc_object_intrusive_storage(std::in_place_t, TArgs && ... args)
+    : object_(gc_construct_object<TObject>(std::forward<TArgs>(args)...)) {
+  }
+
+  TObject object_;
+};
+
+/**
+ * @brief Storage of object allocated by allocate_gc() with allocator that has state,
+ * allocator is kept to release storage back to the same allocator
+ */
+template <typename TObject, typename TAllocator>
+struct gc_object_allocated_storage : gc_object_storage_type<TObject> {
+  template <typename ... TArgs>
+  gc_object_allocated_storage(const TAllocator & allocator, std::in_place_t, TArgs && ... args)
+    : gc_object_storage_type<TObject>(std::in_place, std::forward<TArgs>(args)...)
+    , allocator_{allocator} {
+  }
+
+  TAllocator allocator_;
+};
+
+template <typename TObject, typename TAllocator>
+struct gc_object_intrusive_allocated_storage : gc_object_intrusive_storage<TObject> {
+  template <typename ... TArgs>
+  gc_object_intrusive_allocated_storage(const TAllocator & allocator, std::in_place_t, TArgs && ... args)
+    : gc_object_intrusive_storage<TObject>(std::in_place, std::forward<TArgs>(args)...)
+    , allocator_{allocator} {
+  }
+
+  TAllocator allocator_;
+};
+
+template <typename TObject, typename TAllocator>
+using gc_allocated_storage_type = typename std::conditional<
+    is_gc_enabled<TObject>::value,
+    typename std::conditional<std::allocator_traits<TAllocator>::is_always_equal::value,
+                              gc_object_intrusive_storage<TObject>,
+                              gc_object_intrusive_allocated_storage<TObject, TAllocator>>::type,
+    typename std::conditional<std::allocator_traits<TAllocator>::is_always_equal::value,
+                              gc_object_storage_type<TObject>,
+                              gc_object_allocated_storage<TObject, TAllocator>>::type>::type;
+
+#ifndef GC_POOL_CHUNK_SIZE
+#define GC_POOL_CHUNK_SIZE 65536
+#endif
+
+/**
+ * @brief Size-class slabs for small blocks. Each thread allocates from its own free lists and bump chunk,
+ * free lists of exited thread are handed over to global free lists. Chunks are never returned to system
+ */
+class gc_pool {
+ public:
+  static constexpr std::size_t kGranularity = alignof(std::max_align_t);
+  static constexpr std::size_t kMaxBlockSize = 256;
+  static constexpr std::size_t kSizeClassesCount = kMaxBlockSize / kGranularity;
+
+  static constexpr bool isPooled(const std::size_t size, const std::size_t alignment) noexcept {
+    return size <= kMaxBlockSize && alignment <= kGranularity;
+  }
+
+  static void * allocate(const std::size_t size) {
+    const std::size_t sizeClass = sizeClassOf(size);
+    if (is_thread_cache_destroyed_) {
+      return allocateFromGlobalPool(sizeClass);
+    }
+    auto & sizeClassCache = getThreadCache().size_classes_[sizeClass];
+    if (sizeClassCache.free_list_ == nullptr) {
+      sizeClassCache.free_list_ = takeGlobalFreeList(sizeClass);
+    }
+    if (sizeClassCache.free_list_ != nullptr) {
+      auto blockPtr = sizeClassCache.free_list_;
+      sizeClassCache.free_list_ = blockPtr->next_;
+      return blockPtr;
+    }
+    const std::size_t blockSize = blockSizeOf(sizeClass);
+    if (sizeClassCache.bump_ptr_ == sizeClassCache.bump_end_) {
+      sizeClassCache.bump_ptr_ = allocateChunk();
+      sizeClassCache.bump_end_ = sizeClassCache.bump_ptr_ + GC_POOL_CHUNK_SIZE / blockSize * blockSize;
+    }
+    void * blockPtr = sizeClassCache.bump_ptr_;
+    sizeClassCache.bump_ptr_ += blockSize;
+    return blockPtr;
+  }
+
+  static void deallocate(void * const blockPtr, const std::size_t size) noexcept {
+    const std::size_t sizeClass = sizeClassOf(size);
+    auto freeBlockPtr = static_cast<free_block *>(blockPtr);
+    if (is_thread_cache_destroyed_) {
+      auto & state = getState();
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      freeBlockPtr->next_ = state.free_lists_[sizeClass];
+      state.free_lists_[sizeClass] = freeBlockPtr;
+      return;
+    }
+    auto & sizeClassCache = getThreadCache().size_classes_[sizeClass];
+    freeBlockPtr->next_ = sizeClassCache.free_list_;
+    sizeClassCache.free_list_ = freeBlockPtr;
+  }
+
+ private:
+  static_assert(GC_POOL_CHUNK_SIZE >= kMaxBlockSize, "GC_POOL_CHUNK_SIZE should fit the largest block !!");
+
+  struct free_block {
+    free_block * next_;
+  };
+
+  struct size_class_cache {
+    free_block * free_list_ = nullptr;
+    char * bump_ptr_ = nullptr;
+    char * bump_end_ = nullptr;
+  };
+
+  struct thread_cache {
+    size_class_cache size_classes_[kSizeClassesCount];
+
+    ~thread_cache() {
+      auto & state = getState();
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      for (std::size_t sizeClass = 0; sizeClass < kSizeClassesCount; ++sizeClass) {
+        auto & sizeClassCache = size_classes_[sizeClass];
+        while (sizeClassCache.free_list_ != nullptr) {
+          auto blockPtr = sizeClassCache.free_list_;
+          sizeClassCache.free_list_ = blockPtr->next_;
+          blockPtr->next_ = state.free_lists_[sizeClass];
+          state.free_lists_[sizeClass] = blockPtr;
+        }
+      }
+      // NOTE(redra): Objects destroyed by later thread_local destructors release blocks to global free lists
+      is_thread_cache_destroyed_ = true;
+    }
+  };
+
+  struct pool_state {
+    std::mutex mutex_;
+    free_block * free_lists_[kSizeClassesCount] = {};
+    std::vector<void *> chunks_;
+  };
+
+  static pool_state & getState() {
+    static pool_state state;
+    return state;
+  }
+
+  static thread_cache & getThreadCache() {
+    static thread_local thread_cache threadCache;
+    return threadCache;
+  }
+
+  static constexpr std::size_t sizeClassOf(const std::size_t size) noexcept {
+    return size == 0 ? 0 : (size + kGranularity - 1) / kGranularity - 1;
+  }
+
+  static constexpr std::size_t blockSizeOf(const std::size_t sizeClass) noexcept {
+    return (sizeClass + 1) * kGranularity;
+  }
+
+  static free_block * takeGlobalFreeList(const std::size_t sizeClass) {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    free_block * freeList = nullptr;
+    std::swap(freeList, state.free_lists_[sizeClass]);
+    return freeList;
+  }
+
+  static char * allocateChunk() {
+    auto chunkPtr = static_cast<char *>(::operator new(GC_POOL_CHUNK_SIZE));
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.chunks_.push_back(chunkPtr);
+    return chunkPtr;
+  }
+
+  static void * allocateFromGlobalPool(const std::size_t sizeClass) {
+    {
+      auto & state = getState();
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      if (state.free_lists_[sizeClass] != nullptr) {
+        auto blockPtr = state.free_lists_[sizeClass];
+        state.free_lists_[sizeClass] = blockPtr->next_;
+        return blockPtr;
+      }
+    }
+    return ::operator new(blockSizeOf(sizeClass));
+  }
+
+  static thread_local bool is_thread_cache_destroyed_;
+};
+
+inline thread_local bool gc_pool::is_thread_cache_destroyed_ = false;
+
+/**
+ * @brief Allocator that takes single objects from gc_pool, could be passed to allocate_gc()
+ */
+template <typename T>
+class gc_pool_allocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  gc_pool_allocator() noexcept = default;
+
+  template <typename U>
+  gc_pool_allocator(const gc_pool_allocator<U> &) noexcept {
+  }
+
+  T * allocate(const std::size_t count) {
+    if (count == 1 && gc_pool::isPooled(sizeof(T), alignof(T))) {
+      return static_cast<T *>(gc_pool::allocate(sizeof(T)));
+    }
+    return std::allocator<T>{}.allocate(count);
+  }
+
+  void deallocate(T * const objectPtr, const std::size_t count) noexcept {
+    if (count == 1 && gc_pool::isPooled(sizeof(T), alignof(T))) {
+      gc_pool::deallocate(objectPtr, sizeof(T));
+    } else {
+      std::allocator<T>{}.deallocate(objectPtr, count);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const gc_pool_allocator<U> &) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const gc_pool_allocator<U> &) const noexcept {
+    return false;
+  }
+};
+
+#ifndef GC_REGION_CHUNK_SIZE
+#define GC_REGION_CHUNK_SIZE 1048576
+#endif
+
+template <typename TObject>
+class gc_ptr;
+
+/**
+ * @brief Arena of objects created by make_gc() on this thread while region is alive.
+ * Objects are bump allocated from chunks of GC_REGION_CHUNK_SIZE bytes, object that becomes unreachable earlier
+ * is destroyed as usual, but its memory is released only together with region.
+ * Destruction of region destroys all remaining objects in reverse order of creation without propagation of
+ * their roots to each other and releases all chunks, so nothing outside of region should refer to its objects.
+ * Objects of region are deleted right away even in gc_destruction_mode::deferred, so none of them is queued when
+ * region is destroyed. Objects with gc_cycle_collection policy are not allocated in region
+ */
+class gc_region {
+ public:
+  gc_region()
+    : previous_region_ptr_{current_region_ptr_} {
+    current_region_ptr_ = this;
+  }
+
+  gc_region(const gc_region &) = delete;
+  gc_region & operator=(const gc_region &) = delete;
+
+  ~gc_region() {
+    current_region_ptr_ = previous_region_ptr_;
+    release();
+  }
+
+  /**
+   * @return The innermost region alive on this thread or nullptr
+   */
+  static gc_region * current() noexcept {
+    return current_region_ptr_;
+  }
+
+  /**
+   * @return true if control block belongs to region that destroys its objects on this thread,
+   * root changes of such objects are not propagated
+   */
+  static bool isReleased(const void * const controlBlockPtr) noexcept {
+    return releasing_region_ptr_ != nullptr && releasing_region_ptr_->contains(controlBlockPtr);
+  }
+
+  /**
+   * @return true if control block belongs to region that is alive or destroys its objects on this thread
+   */
+  static bool isAllocated(const void * const controlBlockPtr) noexcept {
+    for (const gc_region * regionPtr = current_region_ptr_; regionPtr != nullptr;
+         regionPtr = regionPtr->previous_region_ptr_) {
+      if (regionPtr->contains(controlBlockPtr)) {
+        return true;
+      }
+    }
+    return isReleased(controlBlockPtr);
+  }
+
+  template <typename TObject, typename ... TArgs>
+  gc_ptr<TObject> make(TArgs && ... args);
+
+  /**
+   * @brief Keeps root in region until region is destroyed. Kept roots are destroyed first,
+   * so graph reachable only from them is destroyed without any propagation
+   */
+  template <typename TObject>
+  gc_ptr<TObject> & keep(gc_ptr<TObject> ptr);
+
+  void * allocate(const std::size_t size, std::size_t alignment) {
+    alignment = std::max(alignment, alignof(std::max_align_t));
+    char * storagePtr = bump_ptr_ != nullptr ? alignUp(bump_ptr_ + sizeof(gc_region_block), alignment) : nullptr;
+    if (storagePtr == nullptr || storagePtr + size > bump_end_) {
+      const std::size_t chunkSize = std::max<std::size_t>(GC_REGION_CHUNK_SIZE,
+                                                          size + sizeof(gc_region_block) + alignment);
+      bump_ptr_ = static_cast<char *>(::operator new(chunkSize));
+      bump_end_ = bump_ptr_ + chunkSize;
+      // NOTE(redra): Chunks are kept sorted by address, so contains() is valid while region is alive
+      const auto chunkIt = std::upper_bound(chunks_.begin(), chunks_.end(), bump_ptr_,
+                                            [](const char * lhsPtr, const gc_region_chunk & rhsChunk) {
+                                              return std::less<const char *>{}(lhsPtr, rhsChunk.begin_);
+                                            });
+      chunks_.insert(chunkIt, {bump_ptr_, bump_end_});
+      storagePtr = alignUp(bump_ptr_ + sizeof(gc_region_block), alignment);
+    }
+    blocks_.push_back(new (storagePtr - sizeof(gc_region_block)) gc_region_block{});
+    bump_ptr_ = storagePtr + size;
+    return storagePtr;
+  }
+
+  /**
+   * @brief Forgets destroyed object, memory stays in chunk until region is destroyed
+   */
+  static void deallocate(void * const storagePtr) noexcept {
+    blockOf(storagePtr)->control_block_ptr_ = nullptr;
+  }
+
+ private:
+  struct gc_region_block {
+    void * object_ptr_ = nullptr;
+    gc_object_control_block * control_block_ptr_ = nullptr;
+    bool is_trivially_destructible_ = false;
+  };
+
+  struct gc_region_chunk {
+    char * begin_;
+    char * end_;
+  };
+
+  struct gc_region_root {
+    void * root_ptr_;
+    void (*destroy_root_)(void * rootPtr);
+  };
+
+  static gc_region_block * blockOf(void * const storagePtr) noexcept {
+    return reinterpret_cast<gc_region_block *>(static_cast<char *>(storagePtr) - sizeof(gc_region_block));
+  }
+
+  static char * alignUp(char * const ptr, const std::size_t alignment) noexcept {
+    const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+    return ptr + ((alignment - address % alignment) % alignment);
+  }
+
+  bool contains(const void * const ptr) const noexcept {
+    const auto chunkIt = std::upper_bound(chunks_.begin(), chunks_.end(), ptr,
+                                          [](const void * lhsPtr, const gc_region_chunk & rhsChunk) {
+                                            return std::less<const void *>{}(lhsPtr, rhsChunk.begin_);
+                                          });
+    return chunkIt != chunks_.begin() && std::less<const void *>{}(ptr, std::prev(chunkIt)->end_);
+  }
+
+  /**
+   * @brief Control block of trivially destructible object without weak anchor and root table owns nothing,
+   * so object is dropped together with chunk
+   */
+  static bool isDisposable(const gc_region_block & block) noexcept {
+    const auto controlBlockPtr = block.control_block_ptr_;
+    const std::uintptr_t rootState = controlBlockPtr->root_state_.load(std::memory_order_acquire);
+    return block.is_trivially_destructible_ && rootState != gc_object_control_block::kSpilledRootState &&
+           controlBlockPtr->weak_anchor_.load(std::memory_order_acquire) == nullptr;
+  }
+
+  void release() {
+    gc_region * const previousReleasingRegionPtr = releasing_region_ptr_;
+    releasing_region_ptr_ = this;
+    for (auto rootIt = roots_.rbegin(); rootIt != roots_.rend(); ++rootIt) {
+      rootIt->destroy_root_(rootIt->root_ptr_);
+    }
+    for (auto blockIt = blocks_.rbegin(); blockIt != blocks_.rend(); ++blockIt) {
+      const gc_region_block & block = **blockIt;
+      if (block.control_block_ptr_ == nullptr) {
+        continue;
+      }
+      if (isDisposable(block)) {
+        GC_STATS_ADD(destroyed_objects_, 1);
+        GC_HEAP_UNREGISTER(block.control_block_ptr_);
+        continue;
+      }
+      block.control_block_ptr_->delete_object_(block.object_ptr_, block.control_block_ptr_);
+    }
+    releasing_region_ptr_ = previousReleasingRegionPtr;
+    for (const auto & chunk : chunks_) {
+      ::operator delete(chunk.begin_);
+    }
+  }
+
+  gc_region * const previous_region_ptr_;
+  char * bump_ptr_ = nullptr;
+  char * bump_end_ = nullptr;
+  std::vector<gc_region_chunk> chunks_;
+  std::vector<gc_region_block *> blocks_;
+  std::vector<gc_region_root> roots_;
+
+  static thread_local gc_region * current_region_ptr_;
+  static thread_local gc_region * releasing_region_ptr_;
+};
+
+inline thread_local gc_region * gc_region::current_region_ptr_ = nullptr;
+inline thread_local gc_region * gc_region::releasing_region_ptr_ = nullptr;
+
+/**
+ * @brief Allocator of allocate_gc() that takes storage from gc_region
+ */
+template <typename T>
+class gc_region_allocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::false_type;
+
+  explicit gc_region_allocator(gc_region & region) noexcept
+    : region_ptr_{&region} {
+  }
+
+  template <typename U>
+  gc_region_allocator(const gc_region_allocator<U> & allocator) noexcept
+    : region_ptr_{allocator.region_ptr_} {
+  }
+
+  T * allocate(const std::size_t count) {
+    return static_cast<T *>(region_ptr_->allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  void deallocate(T * const objectPtr, std::size_t) noexcept {
+    gc_region::deallocate(objectPtr);
+  }
+
+  template <typename U>
+  bool operator==(const gc_region_allocator<U> & allocator) const noexcept {
+    return region_ptr_ == allocator.region_ptr_;
+  }
+
+  template <typename U>
+  bool operator!=(const gc_region_allocator<U> & allocator) const noexcept {
+    return region_ptr_ != allocator.region_ptr_;
+  }
+
+ private:
+  template <typename U>
+  friend class gc_region_allocator;
+
+  gc_region * region_ptr_;
+};
+
+enum class gc_destruction_mode {
+  immediate,
+  deferred,
+  parallel,
+};
+
+#ifndef GC_DEFAULT_DESTRUCTION_MODE
+#define GC_DEFAULT_DESTRUCTION_MODE memory::gc_destruction_mode::immediate
+#endif
+
+/**
+ * @brief Global FIFO of unreachable objects which destruction is deferred.
+ * In gc_destruction_mode::deferred object that lost its last root or reference is queued instead of being deleted
+ * inline, objects are deleted in the order they became unreachable by gc::drain() or by gc_reclaimer thread
+ */
+class gc_destruction_queue {
+ public:
+  static bool isDeferred() noexcept {
+    return getMode().load(std::memory_order_relaxed) == gc_destruction_mode::deferred;
+  }
+
+  static bool isParallel() noexcept {
+    return getMode().load(std::memory_order_relaxed) == gc_destruction_mode::parallel;
+  }
+
+  static void setMode(const gc_destruction_mode mode) noexcept {
+    getMode().store(mode, std::memory_order_relaxed);
+  }
+
+  static gc_destruction_mode mode() noexcept {
+    return getMode().load(std::memory_order_relaxed);
+  }
+
+  static void push(void * const objectPtr, gc_object_control_block * const controlBlockPtr) {
+    push(deferred_object{objectPtr, controlBlockPtr, &deleteRootPropagated});
+  }
+
+  static void push(gc_cycle_control_block * const controlBlockPtr) {
+    push(deferred_object{controlBlockPtr->object_ptr_, controlBlockPtr, &deleteCycleCollected});
+  }
+
+  /**
+   * @return Number of deleted objects, objects queued by destructors of deleted objects are counted in budget
+   */
+  static std::size_t drain(const std::size_t budget) {
+    auto & state = getState();
+    std::size_t deletedCount = 0;
+    while (deletedCount < budget) {
+      deferred_object deferredObject;
+      {
+        std::lock_guard<std::mutex> lock{state.mutex_};
+        if (state.objects_.empty()) {
+          break;
+        }
+        deferredObject = state.objects_.front();
+        state.objects_.pop_front();
+      }
+      deferredObject.delete_object_(deferredObject.object_ptr_, deferredObject.control_block_ptr_);
+      ++deletedCount;
+    }
+    return deletedCount;
+  }
+
+  static std::size_t size() {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    return state.objects_.size();
+  }
+
+ private:
+  friend class gc_reclaimer;
+
+  struct deferred_object {
+    void * object_ptr_;
+    gc_basic_control_block * control_block_ptr_;
+    void (*delete_object_)(void * objectPtr, gc_basic_control_block * controlBlockPtr);
+  };
+
+  struct queue_state {
+    std::mutex mutex_;
+    std::condition_variable is_not_empty_;
+    std::deque<deferred_object> objects_;
+    std::size_t reclaimers_count_ = 0;
+  };
+
+  static std::atomic<gc_destruction_mode> & getMode() noexcept {
+    static std::atomic<gc_destruction_mode> mode{GC_DEFAULT_DESTRUCTION_MODE};
+    return mode;
+  }
+
+  static queue_state & getState() {
+    static queue_state state;
+    return state;
+  }
+
+  static void push(const deferred_object & deferredObject) {
+    auto & state = getState();
+    std::lock_guard<std::mutex> lock{state.mutex_};
+    state.objects_.push_back(deferredObject);
+    if (state.reclaimers_count_ > 0 && state.objects_.size() == 1) {
+      state.is_not_empty_.notify_one();
+    }
+  }
+
+  static void deleteRootPropagated(void * const objectPtr, gc_basic_control_block * const controlBlockPtr) {
+    auto objectControlBlockPtr = static_cast<gc_object_control_block *>(controlBlockPtr);
+    objectControlBlockPtr->delete_object_(objectPtr, objectControlBlockPtr);
+  }
+
+  static void deleteCycleCollected(void *, gc_basic_control_block * const controlBlockPtr) {
+    auto cycleControlBlockPtr = static_cast<gc_cycle_control_block *>(controlBlockPtr);
+    cycleControlBlockPtr->delete_object_(cycleControlBlockPtr);
+  }
+};
+
+/**
+ * @brief Background thread that drains gc_destruction_queue while it is alive.
+ * Objects that are still queued when gc_reclaimer is destroyed are left for gc::drain()
+ */
+class gc_reclaimer {
+ public:
+  explicit gc_reclaimer(const std::size_t budget = 256)
+      : thread_{[this, budget] { run(budget); }} {
+  }
+
+  gc_reclaimer(const gc_reclaimer &) = delete;
+  gc_reclaimer & operator=(const gc_reclaimer &) = delete;
+
+  ~gc_reclaimer() {
+    auto & state = gc_destruction_queue::getState();
+    {
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      is_stopped_ = true;
+    }
+    state.is_not_empty_.notify_all();
+    thread_.join();
+  }
+
+ private:
+  void run(const std::size_t budget) {
+    auto & state = gc_destruction_queue::getState();
+    std::unique_lock<std::mutex> lock{state.mutex_};
+    ++state.reclaimers_count_;
+    while (true) {
+      state.is_not_empty_.wait(lock, [this, &state] {
+        return is_stopped_ || !state.objects_.empty();
+      });
+      if (is_stopped_) {
+        break;
+      }
+      lock.unlock();
+      gc_destruction_queue::drain(budget);
+      lock.lock();
+    }
+    --state.reclaimers_count_;
+  }
+
+  bool is_stopped_ = false;
+  std::thread thread_;
+};
+
+/**
+ * @brief Pending step of root propagation: adds or removes root of object and enqueues its fields
+ */
+struct gc_propagation_task {
+  void (*run_)(const gc_propagation_task & task);
+  void * object_ptr_;
+  gc_object_control_block * control_block_ptr_;
+  const void * root_ptr_;
+  bool is_root_;
+  bool is_removal_ = false;
+};
+
+#ifndef GC_BATCH_LOG_CAPACITY
+#define GC_BATCH_LOG_CAPACITY 4096
+#endif
+
+#ifndef GC_PARALLEL_TEARDOWN_THRESHOLD
+#define GC_PARALLEL_TEARDOWN_THRESHOLD 4096
+#endif
+
+#ifndef GC_TEARDOWN_THREADS
+#define GC_TEARDOWN_THREADS 0
+#endif
+
+/**
+ * @brief Workers of gc_destruction_mode::parallel, created on first parallel teardown and reused by later ones.
+ * Only one teardown runs on workers at a time, teardowns that start meanwhile delete their garbage inline,
+ * so concurrent teardowns never spawn more threads. Workers are never joined and their state is never destroyed,
+ * because garbage could be torn down by destructors of static objects as well
+ */
+class gc_teardown_pool {
+ public:
+  using chunk_function = void (*)(const void * contextPtr, std::size_t chunk);
+
+  /**
+   * @brief Runs function for every chunk of [0, chunksCount) on calling thread and at most maxWorkersCount workers,
+   * returns after all chunks are done
+   * @return false if workers are busy with other teardown, so nothing is run
+   */
+  static bool tryRun(const chunk_function function, const void * const contextPtr, const std::size_t chunksCount,
+                     const std::size_t maxWorkersCount) {
+    auto & state = getState();
+    std::unique_lock<std::mutex> teardownLock{state.teardown_mutex_, std::try_to_lock};
+    if (!teardownLock.owns_lock()) {
+      return false;
+    }
+    std::unique_lock<std::mutex> lock{state.mutex_};
+    // NOTE(redra): Workers are created lazily, if thread could not be created chunks are run by existing threads
+    while (state.workers_count_ < std::min(chunksCount - 1, maxWorkersCount)) {
+      try {
+        std::thread{work}.detach();
+      } catch (const std::system_error &) {
+        break;
+      }
+      ++state.workers_count_;
+    }
+    state.function_ = function;
+    state.context_ptr_ = contextPtr;
+    state.chunks_count_ = chunksCount;
+    state.next_chunk_ = 0;
+    state.pending_chunks_ = chunksCount;
+    state.has_chunks_.notify_all();
+    runChunks(state, lock);
+    state.is_done_.wait(lock, [&state] {
+      return state.pending_chunks_ == 0;
+    });
+    state.chunks_count_ = 0;
+    return true;
+  }
+
+ private:
+  struct pool_state {
+    std::mutex teardown_mutex_;
+    std::mutex mutex_;
+    std::condition_variable has_chunks_;
+    std::condition_variable is_done_;
+    std::size_t workers_count_ = 0;
+    chunk_function function_ = nullptr;
+    const void * context_ptr_ = nullptr;
+    std::size_t chunks_count_ = 0;
+    std::size_t next_chunk_ = 0;
+    std::size_t pending_chunks_ = 0;
+  };
+
+  static pool_state & getState() {
+    static auto statePtr = new pool_state{};
+    return *statePtr;
+  }
+
+  static void runChunks(pool_state & state, std::unique_lock<std::mutex> & lock) {
+    while (state.next_chunk_ < state.chunks_count_) {
+      const std::size_t chunk = state.next_chunk_++;
+      const chunk_function function = state.function_;
+      const void * const contextPtr = state.context_ptr_;
+      lock.unlock();
+      function(contextPtr, chunk);
+      lock.lock();
+      if (--state.pending_chunks_ == 0) {
+        state.is_done_.notify_one();
+      }
+    }
+  }
+
+  static void work() {
+    auto & state = getState();
+    std::unique_lock<std::mutex> lock{state.mutex_};
+    while (true) {
+      state.has_chunks_.wait(lock, [&state] {
+        return state.next_chunk_ < state.chunks_count_;
+      });
+      runChunks(state, lock);
+    }
+  }
+};
+
+/**
+ * @brief Thread-local LIFO of propagation tasks, so root propagation through arbitrarily deep object graph
+ * uses constant stack depth. Every operation that starts propagation remembers size of worklist
+ * and drains it back to that size, therefore propagation started by destructor of deleted object
+ * is finished before outer propagation continues.
+ * Objects that lost their last root are deleted only after all tasks of drain are done, because other tasks
+ * could still refer to them when object is reachable through several edges of cycle.
+ * In gc_destruction_mode::parallel at least GC_PARALLEL_TEARDOWN_THRESHOLD such objects are deleted by
+ * workers of gc_teardown_pool.
+ * Inside of gc::batch_scope drain moves tasks to batch log instead of running them
+ */
+class gc_propagation_worklist {
+ public:
+  static std::size_t size() noexcept {
+    return getTasks().size();
+  }
+
+  static void push(const gc_propagation_task & task) {
+    if (gc_region::isReleased(task.control_block_ptr_)) {
+      return;
+    }
+    getTasks().push_back(task);
+  }
+
+  static void pushGarbage(void * const objectPtr, gc_object_control_block * const controlBlockPtr) {
+    getGarbage().push_back({nullptr, objectPtr, controlBlockPtr, nullptr, false});
+  }
+
+  static void drain(const std::size_t baseSize) {
+    auto & tasks = getTasks();
+    if (isRecording()) {
+      recordBatch(baseSize);
+      return;
+    }
+    auto & garbage = getGarbage();
+    const std::size_t garbageBaseSize = garbage.size();
+    if (tasks.size() > baseSize) {
+      GC_STATS_ADD(propagations_, 1);
+    }
+    // NOTE(redra): Tasks pushed by connected and disconnected fields are counted as well when they are run
+    while (tasks.size() > baseSize) {
+      const gc_propagation_task task = tasks.back();
+      tasks.pop_back();
+      GC_STATS_ADD(propagation_tasks_, 1);
+      task.run_(task);
+    }
+    if (garbage.size() - garbageBaseSize >= GC_PARALLEL_TEARDOWN_THRESHOLD &&
+        gc_destruction_queue::isParallel() && !isTeardownThread()) {
+      deleteInParallel(garbageBaseSize);
+    }
+    while (garbage.size() > garbageBaseSize) {
+      const gc_propagation_task task = garbage.back();
+      garbage.pop_back();
+      deleteObject(task);
+    }
+    if (isIdle()) {
+      gc_root_registry::recycle();
+    }
+  }
+
+  /**
+   * @return true if thread neither propagates nor records batch, so removed root is not referred to by any task
+   */
+  static bool isIdle() noexcept {
+    const auto & batch = getBatch();
+    return getTasks().empty() && batch.depth_ == 0 && !batch.is_applying_;
+  }
+
+  /**
+   * @brief Roots of object whose fields are connected or disconnected, nullptr if object is reachable only
+   * from connected root or is not reachable any more. gc_ptr that is still root when its owner is connected
+   * or disconnected was stored without knowing roots of owner, e.g. inserted into container,
+   * so it becomes field and takes these roots
+   */
+  static const gc_root_table<> *& ownerRoots() noexcept {
+    static thread_local const gc_root_table<> * ownerRoots = nullptr;
+    return ownerRoots;
+  }
+
+  /**
+   * @brief Object of region is not queued, because its memory is released together with region
+   */
+  static void deleteObject(const gc_propagation_task & task) {
+    if (gc_destruction_queue::isDeferred() && !gc_region::isAllocated(task.control_block_ptr_)) {
+      gc_destruction_queue::push(task.object_ptr_, task.control_block_ptr_);
+    } else {
+      task.control_block_ptr_->delete_object_(task.object_ptr_, task.control_block_ptr_);
+    }
+  }
+
+  /**
+   * @brief Splits objects that lost their last root during drain between calling thread and workers of
+   * gc_teardown_pool. Fields of these objects are already disconnected, so destructors do not touch each other,
+   * nested drains of teardown threads delete their garbage inline and drain returns after all chunks are deleted.
+   * Objects are left for inline deletion if workers are busy with teardown started by other thread
+   */
+  static void deleteInParallel(const std::size_t garbageBaseSize) {
+    struct teardown_context {
+      std::vector<gc_propagation_task> objects_;
+      std::size_t chunk_size_;
+    };
+    auto & garbage = getGarbage();
+    const std::size_t threadsCount = std::min(teardownThreadsCount(), garbage.size() - garbageBaseSize);
+    teardown_context context{{}, (garbage.size() - garbageBaseSize + threadsCount - 1) / threadsCount};
+    const auto deleteChunk = [](const void * const contextPtr, const std::size_t chunk) {
+      const auto & context = *static_cast<const teardown_context *>(contextPtr);
+      const std::size_t first = chunk * context.chunk_size_;
+      const std::size_t last = std::min(first + context.chunk_size_, context.objects_.size());
+      bool & isTeardown = isTeardownThread();
+      isTeardown = true;
+      for (std::size_t i = last; i > first; --i) {
+        const gc_propagation_task & task = context.objects_[i - 1];
+        task.control_block_ptr_->delete_object_(task.object_ptr_, task.control_block_ptr_);
+      }
+      isTeardown = false;
+    };
+    context.objects_.assign(garbage.begin() + garbageBaseSize, garbage.end());
+    garbage.resize(garbageBaseSize);
+    if (!gc_teardown_pool::tryRun(deleteChunk, &context, threadsCount, threadsCount - 1)) {
+      garbage.insert(garbage.end(), context.objects_.begin(), context.objects_.end());
+    }
+  }
+
+  /**
+   * @return true if root changes of this thread are recorded into batch log instead of being applied
+   */
+  static bool isRecording() noexcept {
+    const auto & batch = getBatch();
+    return batch.depth_ > 0 && !batch.is_applying_;
+  }
+
+  static void enterBatch() noexcept {
+    ++getBatch().depth_;
+  }
+
+  static void leaveBatch() {
+    if (--getBatch().depth_ == 0) {
+      flushBatch();
+    }
+  }
+
+  /**
+   * @brief Runs function with changes recorded so far applied and with recording suspended,
+   * so roots added by function are propagated before it returns
+   */
+  template <typename TFunction>
+  static void runUnbatched(TFunction && function) {
+    auto & batch = getBatch();
+    if (batch.depth_ == 0 || batch.is_applying_) {
+      function();
+      return;
+    }
+    flushBatch();
+    struct gc_applying_guard {
+      gc_batch_state & batch_;
+
+      ~gc_applying_guard() {
+        batch_.is_applying_ = false;
+      }
+    } guard{batch};
+    batch.is_applying_ = true;
+    function();
+  }
+
+  /**
+   * @brief Applies root changes recorded in batch log. Addition followed by removal of the same root
+   * from the same object cancel each other, remaining additions are applied before removals,
+   * so objects that stay reachable are never destroyed in between.
+   * Reordering does not change result, because log holds only changes of own roots of root gc_ptr and gc_vector:
+   * gc_ptr stored inside of object propagates roots of its owner, so it applies log before it reads them and
+   * object graph does not change between recording and flush. Additions and removals of root of gc_ptr to the object
+   * it points to alternate, so coalescing leaves at most one of them, and root of gc_vector is removed regardless
+   * of count only when vector takes new identity. Changes of different roots are independent and no root
+   * is added after it was erased
+   */
+  static void flushBatch() {
+    auto & batch = getBatch();
+    if (batch.is_applying_ || batch.records_.empty()) {
+      return;
+    }
+    std::vector<gc_propagation_task> records;
+    records.swap(batch.records_);
+    std::vector<bool> isCancelled(records.size(), false);
+    coalesceRecords(records, isCancelled);
+
+    batch.is_applying_ = true;
+    const std::size_t baseSize = size();
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      if (!isCancelled[i] && !records[i].is_removal_) {
+        push(records[i]);
+      }
+    }
+    drain(baseSize);
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      if (!isCancelled[i] && records[i].is_removal_) {
+        push(records[i]);
+      }
+    }
+    drain(baseSize);
+    batch.is_applying_ = false;
+  }
+
+ private:
+  struct gc_batch_state {
+    std::size_t depth_ = 0;
+    bool is_applying_ = false;
+    std::vector<gc_propagation_task> records_;
+  };
+
+  /**
+   * @brief Moves tasks above baseSize to batch log. First root of object is added right away,
+   * so its fields stop being roots exactly when they would without batch
+   */
+  static void recordBatch(const std::size_t baseSize) {
+    auto & tasks = getTasks();
+    auto & batch = getBatch();
+    const std::vector<gc_propagation_task> newTasks(tasks.begin() + baseSize, tasks.end());
+    tasks.resize(baseSize);
+    for (const auto & task : newTasks) {
+      if (!task.is_removal_ && task.control_block_ptr_->hasNoRoots()) {
+        batch.is_applying_ = true;
+        push(task);
+        drain(baseSize);
+        batch.is_applying_ = false;
+      } else {
+        batch.records_.push_back(task);
+      }
+    }
+    if (batch.records_.size() >= GC_BATCH_LOG_CAPACITY) {
+      flushBatch();
+    }
+  }
+
+  /**
+   * @brief Matches every removal with the latest preceding addition of the same root to the same object.
+   * Removal of destroyed root removes root regardless of count, so it cancels all preceding additions,
+   * but is still applied for count that root had before batch
+   */
+  static void coalesceRecords(const std::vector<gc_propagation_task> & records, std::vector<bool> & isCancelled) {
+    std::vector<std::size_t> order(records.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&records](const std::size_t lhs, const std::size_t rhs) {
+      const auto & lhsTask = records[lhs];
+      const auto & rhsTask = records[rhs];
+      if (lhsTask.control_block_ptr_ != rhsTask.control_block_ptr_) {
+        return std::less<gc_object_control_block *>{}(lhsTask.control_block_ptr_, rhsTask.control_block_ptr_);
+      }
+      if (lhsTask.root_ptr_ != rhsTask.root_ptr_) {
+        return std::less<const void *>{}(lhsTask.root_ptr_, rhsTask.root_ptr_);
+      }
+      return lhs < rhs;
+    });
+    std::vector<std::size_t> additions;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      const auto & task = records[order[i]];
+      if (i > 0 && (task.control_block_ptr_ != records[order[i - 1]].control_block_ptr_ ||
+                    task.root_ptr_ != records[order[i - 1]].root_ptr_)) {
+        additions.clear();
+      }
+      if (!task.is_removal_) {
+        additions.push_back(order[i]);
+      } else if (!additions.empty()) {
+        if (task.is_root_) {
+          for (auto additionIndex : additions) {
+            isCancelled[additionIndex] = true;
+          }
+          additions.clear();
+        } else {
+          isCancelled[additions.back()] = true;
+          isCancelled[order[i]] = true;
+          additions.pop_back();
+        }
+      }
+    }
+  }
+
+  static bool & isTeardownThread() noexcept {
+    static thread_local bool isTeardownThread = false;
+    return isTeardownThread;
+  }
+
+  static std::size_t teardownThreadsCount() noexcept {
+    if (GC_TEARDOWN_THREADS > 0) {
+      return GC_TEARDOWN_THREADS;
+    }
+    return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  static gc_batch_state & getBatch() {
+    static thread_local gc_batch_state batch;
+    return batch;
+  }
+
+  static std::vector<gc_propagation_task> & getTasks() {
+    static thread_local std::vector<gc_propagation_task> tasks;
+    return tasks;
+  }
+
+  static std::vector<gc_propagation_task> & getGarbage() {
+    static thread_local std::vector<gc_propagation_task> garbage;
+    return garbage;
+  }
+};
+
+inline void gc_root_registry::release(const gc_root_id rootId) {
+  if (is_thread_cache_destroyed_) {
+    std::vector<gc_root_id> rootIds{rootId};
+    giveBlock(rootIds);
+    return;
+  }
+  auto & threadCache = getThreadCache();
+  if (gc_propagation_worklist::isIdle()) {
+    threadCache.free_root_ids_.push_back(rootId);
+    trim(threadCache.free_root_ids_);
+  } else {
+    threadCache.pending_root_ids_.push_back(rootId);
+  }
+}
+
+/**
+ * @brief Possible cycle roots buffered by one thread. Buffer is never destroyed, buffer of exited thread
+ * is handed over to the next started thread, so control block could always lock buffer that holds it
+ */
+struct gc_cycle_buffer {
+  std::mutex mutex_;
+  std::vector<gc_cycle_control_block *> possible_roots_;
+  bool is_collecting_ = false;
+};
+
+/**
+ * @brief Reference counting with synchronous cycle collection from
+ * "Concurrent Cycle Collection in Reference Counted Systems" by D. F. Bacon and V. T. Rajan.
+ * Children of object are enumerated by generated connectToRoot() called with traceRootPtr(),
+ * all traversals use explicit stack
+ */
+class gc_cycle_collector {
+ public:
+  static const void * traceRootPtr() noexcept {
+    static const char traceTag = 0;
+    return &traceTag;
+  }
+
+  static void acquire(gc_cycle_control_block * const controlBlockPtr) noexcept {
+    controlBlockPtr->strong_count_.fetch_add(1, std::memory_order_relaxed);
+    controlBlockPtr->color_.store(gc_cycle_color::black, std::memory_order_relaxed);
+  }
+
+  static void release(gc_cycle_control_block * const controlBlockPtr) {
+    if (controlBlockPtr->strong_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      if (controlBlockPtr->buffer_ptr_.load(std::memory_order_acquire) != nullptr) {
+        removePossibleRoot(controlBlockPtr);
+      }
+      if (gc_destruction_queue::isDeferred()) {
+        gc_destruction_queue::push(controlBlockPtr);
+      } else {
+        controlBlockPtr->delete_object_(controlBlockPtr);
+      }
+    } else {
+      addPossibleRoot(controlBlockPtr);
+    }
+  }
+
+  /**
+   * @brief Called by gc_ptr that is visited by trace of its owner
+   * @return true if gc_ptr should forget its object, because owner is destroyed as part of garbage cycle
+   */
+  static bool traceChild(gc_cycle_control_block * const controlBlockPtr) {
+    if (trace_children_ptr_ == nullptr) {
+      return true;
+    }
+    trace_children_ptr_->push_back(controlBlockPtr);
+    return false;
+  }
+
+  /**
+   * @brief Collects possible roots of this thread and of exited threads
+   * @return Number of destroyed objects
+   */
+  static std::size_t collectCycles() {
+    auto & state = getState();
+    std::size_t destroyedCount = is_thread_buffer_retired_ ? 0 : collectBuffer(threadBuffer());
+    std::vector<gc_cycle_buffer *> retiredBuffers;
+    {
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      retiredBuffers.swap(state.retired_buffers_);
+    }
+    for (auto bufferPtr : retiredBuffers) {
+      destroyedCount += collectBuffer(*bufferPtr);
+    }
+    destroyedCount += collectBuffer(state.orphan_buffer_);
+    {
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      state.retired_buffers_.insert(state.retired_buffers_.end(), retiredBuffers.begin(), retiredBuffers.end());
+    }
+    GC_STATS_ADD(cycle_collections_, 1);
+    return destroyedCount;
+  }
+
+ private:
+  struct collector_state {
+    std::mutex mutex_;
+    // NOTE(redra): Garbage cycle could span buffers of several threads, so collections take it one at a time
+    std::mutex collection_mutex_;
+    std::vector<gc_cycle_buffer *> retired_buffers_;
+    // NOTE(redra): Used by thread_local destructors that run after buffer of thread is retired
+    gc_cycle_buffer orphan_buffer_;
+  };
+
+  struct gc_thread_buffer {
+    gc_cycle_buffer * buffer_ptr_;
+
+    gc_thread_buffer()
+      : buffer_ptr_{takeRetiredBuffer()} {
+    }
+
+    ~gc_thread_buffer() {
+      auto & state = getState();
+      {
+        std::lock_guard<std::mutex> lock{state.mutex_};
+        state.retired_buffers_.push_back(buffer_ptr_);
+      }
+      is_thread_buffer_retired_ = true;
+    }
+  };
+
+  // NOTE(redra): State is never destroyed, so control blocks released after static destruction still could lock buffer
+  static collector_state & getState() {
+    static auto statePtr = new collector_state{};
+    return *statePtr;
+  }
+
+  static gc_cycle_buffer * takeRetiredBuffer() {
+    auto & state = getState();
+    {
+      std::lock_guard<std::mutex> lock{state.mutex_};
+      if (!state.retired_buffers_.empty()) {
+        gc_cycle_buffer * const bufferPtr = state.retired_buffers_.back();
+        state.retired_buffers_.pop_back();
+        return bufferPtr;
+      }
+    }
+    return new gc_cycle_buffer{};
+  }
+
+  static gc_cycle_buffer & threadBuffer() {
+    if (is_thread_buffer_retired_) {
+      return getState().orphan_buffer_;
+    }
+    static thread_local gc_thread_buffer threadBuffer;
+    return *threadBuffer.buffer_ptr_;
+  }
+
+  /**
+   * @brief Collection locks buffers of other threads only to take their objects out of them, while it holds
+   * collection_mutex_, so no two threads wait for each other's buffers
+   * @return Number of destroyed objects
+   */
+  static std::size_t collectBuffer(gc_cycle_buffer & buffer) {
+    std::vector<gc_cycle_control_block *> possibleRoots;
+    std::vector<gc_cycle_control_block *> garbage;
+    {
+      std::lock_guard<std::mutex> collectionLock{getState().collection_mutex_};
+      std::lock_guard<std::mutex> lock{buffer.mutex_};
+      if (buffer.is_collecting_ || buffer.possible_roots_.empty()) {
+        return 0;
+      }
+      buffer.is_collecting_ = true;
+      possibleRoots.swap(buffer.possible_roots_);
+      markRoots(possibleRoots);
+      scanRoots(possibleRoots);
+      collectRoots(possibleRoots, buffer, garbage);
+    }
+    // NOTE(redra): References between garbage objects were already subtracted by trial deletion,
+    //  so gc_ptr inside garbage forget their objects before any destructor is called
+    for (auto controlBlockPtr : garbage) {
+      controlBlockPtr->trace_object_(controlBlockPtr->object_ptr_);
+    }
+    for (auto controlBlockPtr : garbage) {
+      controlBlockPtr->delete_object_(controlBlockPtr);
+    }
+    {
+      std::lock_guard<std::mutex> lock{buffer.mutex_};
+      buffer.is_collecting_ = false;
+    }
+    GC_STATS_ADD(cycle_reclaimed_objects_, garbage.size());
+    return garbage.size();
+  }
+
+  /**
+   * @brief Buffers object in buffer of this thread, buffer is locked by other threads only to remove their objects
+   */
+  static void addPossibleRoot(gc_cycle_control_block * const controlBlockPtr) {
+    if (controlBlockPtr->color_.load(std::memory_order_relaxed) == gc_cycle_color::purple) {
+      return;
+    }
+    controlBlockPtr->color_.store(gc_cycle_color::purple, std::memory_order_relaxed);
+    auto & buffer = threadBuffer();
+    bool isCollectionNeeded;
+    {
+      std::lock_guard<std::mutex> lock{buffer.mutex_};
+      if (controlBlockPtr->buffer_ptr_.load(std::memory_order_relaxed) == nullptr) {
+        buffer.possible_roots_.push_back(controlBlockPtr);
+        gc_cycle_buffer * expectedBufferPtr = nullptr;
+        // NOTE(redra): Other thread could buffer the same object into its own buffer at the same time
+        if (controlBlockPtr->buffer_ptr_.compare_exchange_strong(expectedBufferPtr, &buffer,
+                                                                 std::memory_order_acq_rel)) {
+          controlBlockPtr->buffer_index_ = buffer.possible_roots_.size() - 1;
+        } else {
+          buffer.possible_roots_.pop_back();
+        }
+      }
+      isCollectionNeeded = &buffer != &getState().orphan_buffer_ && !buffer.is_collecting_ &&
+                           buffer.possible_roots_.size() >= GC_CYCLE_COLLECTION_THRESHOLD;
+    }
+    if (isCollectionNeeded) {
+      collectBuffer(buffer);
+      GC_STATS_ADD(cycle_collections_, 1);
+    }
+  }
+
+  /**
+   * @brief Forgets object that is destroyed. Buffer that held object is checked again under its mutex,
+   * because collection could have taken object out of buffer in between
+   */
+  static void removePossibleRoot(gc_cycle_control_block * const controlBlockPtr) {
+    while (true) {
+      gc_cycle_buffer * const bufferPtr = controlBlockPtr->buffer_ptr_.load(std::memory_order_acquire);
+      if (bufferPtr == nullptr) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock{bufferPtr->mutex_};
+      if (controlBlockPtr->buffer_ptr_.load(std::memory_order_relaxed) == bufferPtr) {
+        bufferPtr->possible_roots_[controlBlockPtr->buffer_index_] = nullptr;
+        controlBlockPtr->buffer_ptr_.store(nullptr, std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  static gc_cycle_color colorOf(const gc_cycle_control_block * const controlBlockPtr) noexcept {
+    return controlBlockPtr->color_.load(std::memory_order_relaxed);
+  }
+
+  static void paint(gc_cycle_control_block * const controlBlockPtr, const gc_cycle_color color) noexcept {
+    controlBlockPtr->color_.store(color, std::memory_order_relaxed);
+  }
+
+  static void traceChildren(const gc_cycle_control_block * const controlBlockPtr,
+                            std::vector<gc_cycle_control_block *> & children) {
+    children.clear();
+    trace_children_ptr_ = &children;
+    controlBlockPtr->trace_object_(controlBlockPtr->object_ptr_);
+    trace_children_ptr_ = nullptr;
+  }
+
+  static void markRoots(std::vector<gc_cycle_control_block *> & possibleRoots) {
+    for (auto & controlBlockPtr : possibleRoots) {
+      if (controlBlockPtr == nullptr) {
+        continue;
+      }
+      if (colorOf(controlBlockPtr) == gc_cycle_color::purple &&
+          controlBlockPtr->strong_count_.load(std::memory_order_relaxed) > 0) {
+        markGray(controlBlockPtr);
+      } else {
+        controlBlockPtr->buffer_ptr_.store(nullptr, std::memory_order_relaxed);
+        controlBlockPtr = nullptr;
+      }
+    }
+  }
+
+  static void scanRoots(const std::vector<gc_cycle_control_block *> & possibleRoots) {
+    for (auto controlBlockPtr : possibleRoots) {
+      if (controlBlockPtr != nullptr) {
+        scan(controlBlockPtr);
+      }
+    }
+  }
+
+  static void collectRoots(const std::vector<gc_cycle_control_block *> & possibleRoots,
+                           const gc_cycle_buffer & buffer,
+                           std::vector<gc_cycle_control_block *> & garbage) {
+    for (auto controlBlockPtr : possibleRoots) {
+      if (controlBlockPtr != nullptr) {
+        controlBlockPtr->buffer_ptr_.store(nullptr, std::memory_order_relaxed);
+        collectWhite(controlBlockPtr, buffer, garbage);
+      }
+    }
+  }
+
+  static void markGray(gc_cycle_control_block * const controlBlockPtr) {
+    if (colorOf(controlBlockPtr) == gc_cycle_color::gray) {
+      return;
+    }
+    paint(controlBlockPtr, gc_cycle_color::gray);
+    std::vector<gc_cycle_control_block *> stack{controlBlockPtr};
+    std::vector<gc_cycle_control_block *> children;
+    while (!stack.empty()) {
+      auto objectControlBlockPtr = stack.back();
+      stack.pop_back();
+      traceChildren(objectControlBlockPtr, children);
+      for (auto childControlBlockPtr : children) {
+        childControlBlockPtr->strong_count_.fetch_sub(1, std::memory_order_relaxed);
+        if (colorOf(childControlBlockPtr) != gc_cycle_color::gray) {
+          paint(childControlBlockPtr, gc_cycle_color::gray);
+          stack.push_back(childControlBlockPtr);
+        }
+      }
+    }
+  }
+
+  static void scan(gc_cycle_control_block * const controlBlockPtr) {
+    std::vector<gc_cycle_control_block *> stack{controlBlockPtr};
+    std::vector<gc_cycle_control_block *> children;
+    while (!stack.empty()) {
+      auto objectControlBlockPtr = stack.back();
+      stack.pop_back();
+      if (colorOf(objectControlBlockPtr) != gc_cycle_color::gray) {
+        continue;
+      }
+      if (objectControlBlockPtr->strong_count_.load(std::memory_order_relaxed) > 0) {
+        scanBlack(objectControlBlockPtr);
+      } else {
+        paint(objectControlBlockPtr, gc_cycle_color::white);
+        traceChildren(objectControlBlockPtr, children);
+        stack.insert(stack.end(), children.begin(), children.end());
+      }
+    }
+  }
+
+  static void scanBlack(gc_cycle_control_block * const controlBlockPtr) {
+    paint(controlBlockPtr, gc_cycle_color::black);
+    std::vector<gc_cycle_control_block *> stack{controlBlockPtr};
+    std::vector<gc_cycle_control_block *> children;
+    while (!stack.empty()) {
+      auto objectControlBlockPtr = stack.back();
+      stack.pop_back();
+      traceChildren(objectControlBlockPtr, children);
+      for (auto childControlBlockPtr : children) {
+        childControlBlockPtr->strong_count_.fetch_add(1, std::memory_order_relaxed);
+        if (colorOf(childControlBlockPtr) != gc_cycle_color::black) {
+          paint(childControlBlockPtr, gc_cycle_color::black);
+          stack.push_back(childControlBlockPtr);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Every white object reachable from root is garbage, trial deletion already subtracted its references
+   */
+  static void collectWhite(gc_cycle_control_block * const controlBlockPtr,
+                           const gc_cycle_buffer & buffer,
+                           std::vector<gc_cycle_control_block *> & garbage) {
+    if (!takeWhite(controlBlockPtr, buffer)) {
+      return;
+    }
+    paint(controlBlockPtr, gc_cycle_color::black);
+    std::vector<gc_cycle_control_block *> stack{controlBlockPtr};
+    std::vector<gc_cycle_control_block *> children;
+    while (!stack.empty()) {
+      auto objectControlBlockPtr = stack.back();
+      stack.pop_back();
+      garbage.push_back(objectControlBlockPtr);
+      traceChildren(objectControlBlockPtr, children);
+      for (auto childControlBlockPtr : children) {
+        if (takeWhite(childControlBlockPtr, buffer)) {
+          paint(childControlBlockPtr, gc_cycle_color::black);
+          stack.push_back(childControlBlockPtr);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief White possible root of collected buffer is left to collectRoots(). White object buffered by other
+   * thread is taken out of its buffer, so that buffer never sees object which references were subtracted
+   * @return true if white object should be collected right away
+   */
+  static bool takeWhite(gc_cycle_control_block * const controlBlockPtr, const gc_cycle_buffer & buffer) {
+    if (colorOf(controlBlockPtr) != gc_cycle_color::white) {
+      return false;
+    }
+    gc_cycle_buffer * const bufferPtr = controlBlockPtr->buffer_ptr_.load(std::memory_order_acquire);
+    if (bufferPtr == &buffer) {
+      return false;
+    }
+    if (bufferPtr != nullptr) {
+      std::lock_guard<std::mutex> lock{bufferPtr->mutex_};
+      bufferPtr->possible_roots_[controlBlockPtr->buffer_index_] = nullptr;
+      controlBlockPtr->buffer_ptr_.store(nullptr, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  static thread_local std::vector<gc_cycle_control_block *> * trace_children_ptr_;
+  static thread_local bool is_thread_buffer_retired_;
+};
+
+inline thread_local std::vector<gc_cycle_control_block *> * gc_cycle_collector::trace_children_ptr_ = nullptr;
+inline thread_local bool gc_cycle_collector::is_thread_buffer_retired_ = false;
+
+#ifdef GC_ENABLE_HEAP_DUMP
+
+enum class gc_heap_dump_format {
+  json,
+  dot
+};
+
+/**
+ * @brief Writes heap snapshot as JSON document or DOT graph. Roots are reported with gc_ptr that holds them,
+ * object that contains that gc_ptr if any, and number of objects and bytes they keep alive,
+ * sorted from the biggest one, objects are reported with their roots
+ */
+class gc_heap_dump {
+ public:
+  static void write(std::ostream & stream, const gc_heap_snapshot & snapshot, const gc_heap_dump_format format) {
+    std::vector<const gc_heap_object *> objects;
+    objects.reserve(snapshot.objects_.size());
+    for (const auto & object : snapshot.objects_) {
+      objects.push_back(&object);
+    }
+    std::sort(objects.begin(), objects.end(), [](const gc_heap_object * lhs, const gc_heap_object * rhs) {
+      return std::less<const void *>{}(lhs->object_ptr_, rhs->object_ptr_);
+    });
+    const std::vector<gc_root_summary> roots = summarizeRoots(snapshot, objects);
+    if (format == gc_heap_dump_format::json) {
+      writeJson(stream, objects, roots);
+    } else {
+      writeDot(stream, objects, roots);
+    }
+  }
+
+ private:
+  struct gc_root_summary {
+    const void * root_ptr_;
+    // NOTE(redra): nullptr if gc_ptr of root is unknown, i.e. root was added before GC_ENABLE_HEAP_DUMP took effect
+    const gc_heap_root * root_info_ptr_ = nullptr;
+    // NOTE(redra): Object that contains gc_ptr of root, e.g. gc_ptr stored in container after object was connected
+    const gc_heap_object * owner_ptr_ = nullptr;
+    std::size_t object_count_ = 0;
+    std::size_t retained_bytes_ = 0;
+  };
+
+  static std::vector<gc_root_summary> summarizeRoots(const gc_heap_snapshot & snapshot,
+                                                     const std::vector<const gc_heap_object *> & objects) {
+    std::unordered_map<const void *, gc_root_summary> summaries;
+    for (const auto & root : snapshot.roots_) {
+      auto & summary = summaries[root.root_ptr_];
+      summary.root_ptr_ = root.root_ptr_;
+      summary.root_info_ptr_ = &root;
+      summary.owner_ptr_ = findOwner(objects, root.holder_ptr_);
+    }
+    for (auto objectPtr : objects) {
+      for (const auto & rootCount : objectPtr->root_counts_) {
+        auto & summary = summaries[rootCount.rootPtr()];
+        summary.root_ptr_ = rootCount.rootPtr();
+        summary.object_count_ += 1;
+        summary.retained_bytes_ += objectPtr->size_;
+      }
+    }
+    std::vector<gc_root_summary> roots;
+    roots.reserve(summaries.size());
+    for (auto & summary : summaries) {
+      if (summary.second.object_count_ > 0) {
+        roots.push_back(summary.second);
+      }
+    }
+    std::sort(roots.begin(), roots.end(), [](const gc_root_summary & lhs, const gc_root_summary & rhs) {
+      return lhs.retained_bytes_ != rhs.retained_bytes_ ? lhs.retained_bytes_ > rhs.retained_bytes_
+                                                        : rootId(lhs.root_ptr_) < rootId(rhs.root_ptr_);
+    });
+    return roots;
+  }
+
+  static const gc_heap_object * findOwner(const std::vector<const gc_heap_object *> & objects,
+                                          const void * const holderPtr) {
+    auto position = std::upper_bound(objects.begin(), objects.end(), holderPtr,
+                                     [](const void * holderPtr, const gc_heap_object * objectPtr) {
+      return std::less<const void *>{}(holderPtr, objectPtr->object_ptr_);
+    });
+    if (position == objects.begin()) {
+      return nullptr;
+    }
+    const gc_heap_object * const objectPtr = *std::prev(position);
+    const auto objectAddress = reinterpret_cast<std::uintptr_t>(objectPtr->object_ptr_);
+    const auto holderAddress = reinterpret_cast<std::uintptr_t>(holderPtr);
+    return holderAddress < objectAddress + objectPtr->size_ ? objectPtr : nullptr;
+  }
+
+  static std::uintptr_t rootId(const void * const rootPtr) noexcept {
+    return reinterpret_cast<std::uintptr_t>(rootPtr);
+  }
+
+  static void writeEscaped(std::ostream & stream, const std::string & text) {
+    for (const char symbol : text) {
+      if (symbol == '"' || symbol == '\\') {
+        stream << '\\';
+      }
+      stream << symbol;
+    }
+  }
+
+  static void writeJson(std::ostream & stream,
+                        const std::vector<const gc_heap_object *> & objects,
+                        const std::vector<gc_root_summary> & roots) {
+    stream << "{\n  \"objects\": [";
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+      const gc_heap_object & object = *objects[i];
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"address\": \"" << object.object_ptr_ << "\", \"type\": \"";
+      writeEscaped(stream, object.type_name_);
+      stream << "\", \"size\": " << object.size_ << ", \"roots\": [";
+      for (std::size_t j = 0; j < object.root_counts_.size(); ++j) {
+        stream << (j == 0 ? "" : ", ") << "{\"root\": " << rootId(object.root_counts_[j].rootPtr())
+               << ", \"count\": " << object.root_counts_[j].count_ << "}";
+      }
+      // NOTE(redra): Object without roots is unreachable and waits in destruction queue
+      stream << "], \"pending_destruction\": " << (object.root_counts_.empty() ? "true" : "false") << "}";
+    }
+    stream << "\n  ],\n  \"roots\": [";
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+      const gc_root_summary & root = roots[i];
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"root\": " << rootId(root.root_ptr_);
+      if (root.root_info_ptr_ != nullptr) {
+        stream << ", \"holder\": \"" << root.root_info_ptr_->holder_ptr_ << "\"";
+        if (root.root_info_ptr_->target_ptr_ != nullptr) {
+          stream << ", \"target\": \"" << root.root_info_ptr_->target_ptr_ << "\"";
+        }
+      }
+      if (root.owner_ptr_ != nullptr) {
+        stream << ", \"owner\": \"" << root.owner_ptr_->object_ptr_ << "\", \"owner_type\": \"";
+        writeEscaped(stream, root.owner_ptr_->type_name_);
+        stream << "\"";
+      }
+      stream << ", \"objects\": " << root.object_count_ << ", \"bytes\": " << root.retained_bytes_ << "}";
+    }
+    stream << "\n  ]\n}\n";
+  }
+
+  static void writeDot(std::ostream & stream,
+                       const std::vector<const gc_heap_object *> & objects,
+                       const std::vector<gc_root_summary> & roots) {
+    stream << "digraph gc_heap {\n  node [shape=box];\n";
+    for (const auto objectPtr : objects) {
+      stream << "  \"" << objectPtr->object_ptr_ << "\" [label=\"";
+      writeEscaped(stream, objectPtr->type_name_);
+      stream << "\\n" << objectPtr->object_ptr_ << "\\n" << objectPtr->size_ << " bytes\"";
+      stream << (objectPtr->root_counts_.empty() ? ", style=dashed" : "") << "];\n";
+    }
+    for (const auto & root : roots) {
+      stream << "  \"root " << rootId(root.root_ptr_) << "\" [shape=ellipse, label=\"root " << rootId(root.root_ptr_);
+      if (root.root_info_ptr_ != nullptr) {
+        stream << "\\nheld at " << root.root_info_ptr_->holder_ptr_;
+      }
+      stream << "\\n" << root.object_count_ << " objects, " << root.retained_bytes_ << " bytes\"];\n";
+      if (root.owner_ptr_ != nullptr) {
+        stream << "  \"" << root.owner_ptr_->object_ptr_ << "\" -> \"root " << rootId(root.root_ptr_)
+               << "\" [style=dashed];\n";
+      }
+    }
+    for (const auto objectPtr : objects) {
+      for (const auto & rootCount : objectPtr->root_counts_) {
+        stream << "  \"root " << rootId(rootCount.rootPtr()) << "\" -> \"" << objectPtr->object_ptr_ << "\"";
+        if (rootCount.count_ > 1) {
+          stream << " [label=\"" << rootCount.count_ << "\"]";
+        }
+        stream << ";\n";
+      }
+    }
+    stream << "}\n";
+  }
+};
+
+#endif
+
+namespace gc {
+
+/**
+ * @brief Synchronously destroys unreachable cycles of objects with gc_cycle_collection policy
+ * that were buffered by this thread or by already exited threads
+ * @return Number of destroyed objects
+ */
+inline std::size_t collect_cycles() {
+  return gc_cycle_collector::collectCycles();
+}
+
+/**
+ * @brief Selects whether unreachable objects are deleted inline, queued for drain() or gc_reclaimer
+ * or deleted inline by several threads when they are many
+ */
+inline void set_destruction_mode(const gc_destruction_mode mode) noexcept {
+  gc_destruction_queue::setMode(mode);
+}
+
+inline gc_destruction_mode destruction_mode() noexcept {
+  return gc_destruction_queue::mode();
+}
+
+/**
+ * @brief Deletes up to budget queued unreachable objects in the order they became unreachable
+ * @return Number of deleted objects
+ */
+inline std::size_t drain(const std::size_t budget = std::numeric_limits<std::size_t>::max()) {
+  return gc_destruction_queue::drain(budget);
+}
+
+/**
+ * @brief Records root additions and removals of gc_ptr with gc_root_propagation policy done by this thread
+ * and applies them at exit of outermost scope, by flush() or when GC_BATCH_LOG_CAPACITY changes are recorded.
+ * Addition followed by removal of the same root from the same object cancel each other,
+ * objects that became unreachable are destroyed at flush. Only changes of root gc_ptr and gc_vector are recorded,
+ * assignment of gc_ptr or gc_vector stored inside of object applies recorded changes and itself right away.
+ * NOTE: Batch log refers to objects without keeping them alive, so objects touched inside of scope should not
+ * lose their last root on other thread until flush
+ */
+class batch_scope {
+ public:
+  batch_scope() noexcept {
+    gc_propagation_worklist::enterBatch();
+  }
+
+  batch_scope(const batch_scope &) = delete;
+  batch_scope & operator=(const batch_scope &) = delete;
+
+  ~batch_scope() {
+    gc_propagation_worklist::leaveBatch();
+  }
+
+  /**
+   * @brief Applies changes recorded so far, scope continues recording after that
+   */
+  static void flush() {
+    gc_propagation_worklist::flushBatch();
+  }
+};
+
+#ifdef GC_ENABLE_HEAP_DUMP
+
+/**
+ * @brief Copies all live objects with gc_root_propagation policy together with their roots
+ * and all roots together with gc_ptr that hold them
+ */
+inline gc_heap_snapshot heap_snapshot() {
+  return gc_heap_registry::snapshot();
+}
+
+/**
+ * @brief Writes heap_snapshot() into stream as JSON document or DOT graph
+ */
+inline void dump_heap(std::ostream & stream, const gc_heap_dump_format format = gc_heap_dump_format::json) {
+  gc_heap_dump::write(stream, heap_snapshot(), format);
+}
+
+#endif
+
+}
+
+template <typename T, typename = void>
+struct gc_trace_traits;
+
+/**
+ * @brief Checks if field of type T should be traced: it has generated trace methods
+ * or it is standard container, std::pair, std::tuple, std::optional or std::variant of such fields
+ */
+template <typename T>
+struct is_gc_traced : std::bool_constant<has_use_gc_ptr<T>::value || gc_trace_traits<T>::value> {
+};
+
+template <typename T, typename>
+struct gc_trace_traits : std::false_type {
+};
+
+/**
+ * @brief Traces elements of any range: standard sequence and associative containers and std::array.
+ * Elements are visited by loop over iterators with inlined visitor, so contiguous storage is iterated tightly
+ */
+template <typename T>
+struct gc_trace_traits<T, std::void_t<typename T::value_type,
+                                      decltype(std::begin(std::declval<const T &>())),
+                                      decltype(std::end(std::declval<const T &>()))>>
+    : std::bool_constant<is_gc_traced<typename T::value_type>::value> {
+  template <typename TVisitor>
+  static void forEach(const T & range, TVisitor && visitor) {
+    for (const auto & element : range) {
+      visitor(element);
+    }
+  }
+};
+
+template <typename TFirst, typename TSecond>
+struct gc_trace_traits<std::pair<TFirst, TSecond>>
+    : std::bool_constant<is_gc_traced<std::remove_cv_t<TFirst>>::value ||
+                         is_gc_traced<std::remove_cv_t<TSecond>>::value> {
+  template <typename TVisitor>
+  static void forEach(const std::pair<TFirst, TSecond> & pair, TVisitor && visitor) {
+    visitor(pair.first);
+    visitor(pair.second);
+  }
+};
+
+template <typename ... TElements>
+struct gc_trace_traits<std::tuple<TElements...>>
+    : std::bool_constant<(is_gc_traced<std::remove_cv_t<TElements>>::value || ...)> {
+  template <typename TVisitor>
+  static void forEach(const std::tuple<TElements...> & tuple, TVisitor && visitor) {
+    std::apply([&visitor](const auto & ... elements) { (visitor(elements), ...); }, tuple);
+  }
+};
+
+template <typename TValue>
+struct gc_trace_traits<std::optional<TValue>> : std::bool_constant<is_gc_traced<TValue>::value> {
+  template <typename TVisitor>
+  static void forEach(const std::optional<TValue> & optional, TVisitor && visitor) {
+    if (optional.has_value()) {
+      visitor(*optional);
+    }
+  }
+};
+
+template <typename ... TAlternatives>
+struct gc_trace_traits<std::variant<TAlternatives...>>
+    : std::bool_constant<(is_gc_traced<TAlternatives>::value || ...)> {
+  template <typename TVisitor>
+  static void forEach(const std::variant<TAlternatives...> & variant, TVisitor && visitor) {
+    if (!variant.valueless_by_exception()) {
+      std::visit([&visitor](const auto & alternative) { visitor(alternative); }, variant);
+    }
+  }
+};
+
+template <typename TBase, typename TDerived>
+inline void call_ConnectBaseToRoot(TDerived * derivedPtr, const void * rootPtr) {
+  if constexpr (memory::has_use_gc_ptr<TBase>::value) {
+    derivedPtr->TBase::connectToRoot(rootPtr);
+  }
+}
+
+template <typename TExact, typename TDeduced>
+inline void call_ConnectFieldToRoot(TDeduced & t, const void * rootPtr) {
+  if constexpr (!std::is_pointer<TExact>::value &&
+                !std::is_reference<TExact>::value &&
+                memory::has_use_gc_ptr<TExact>::value) {
+    t.connectToRoot(rootPtr);
+  } else if constexpr (!std::is_pointer<TExact>::value &&
+                       !std::is_reference<TExact>::value &&
+                       gc_trace_traits<std::remove_cv_t<TExact>>::value) {
+    gc_trace_traits<std::remove_cv_t<TExact>>::forEach(t, [rootPtr](const auto & element) {
+      call_ConnectFieldToRoot<std::remove_cv_t<std::remove_reference_t<decltype(element)>>>(element, rootPtr);
+    });
+  }
+}
+
+template <typename TBase, typename TDerived>
+inline void call_DisconnectBaseFromRoot(TDerived * derivedPtr, const bool isRoot, const void * rootPtr) {
+  if constexpr (memory::has_use_gc_ptr<TBase>::value) {
+    derivedPtr->TBase::disconnectFromRoot(isRoot, rootPtr);
+  }
+}
+
+template <typename TExact, typename TDeduced>
+inline void call_DisconnectFieldFromRoot(TDeduced & t, const bool isRoot, const void * rootPtr) {
+  if constexpr (!std::is_pointer<TExact>::value &&
+                !std::is_reference<TExact>::value &&
+                memory::has_use_gc_ptr<TExact>::value) {
+    t.disconnectFromRoot(isRoot, rootPtr);
+  } else if constexpr (!std::is_pointer<TExact>::value &&
+                       !std::is_reference<TExact>::value &&
+                       gc_trace_traits<std::remove_cv_t<TExact>>::value) {
+    gc_trace_traits<std::remove_cv_t<TExact>>::forEach(t, [isRoot, rootPtr](const auto & element) {
+      call_DisconnectFieldFromRoot<std::remove_cv_t<std::remove_reference_t<decltype(element)>>>(element, isRoot, rootPtr);
+    });
+  }
+}
+
+template <typename TMember>
+struct gc_member_traits;
+
+template <typename TClass, typename TField>
+struct gc_member_traits<TField TClass::*> {
+  using class_type = TClass;
+  using field_type = TField;
+};
+
+/**
+ * @brief Compile-time table of traced fields given by pointers to members, e.g.
+ * gc_trace_table<&Node::next_ptr_, &Node::children_>. Tracing is unrolled over table at compile time,
+ * so connecting object is straight-line sequence of field updates without calls that compiler could not flatten.
+ * Pointers to members are used instead of offsetof(), so fields of classes that are not standard layout are supported
+ */
+template <auto ... TMembers>
+struct gc_trace_table {
+  static constexpr std::size_t kFieldCount = sizeof...(TMembers);
+
+  template <typename TObject>
+  static void connectToRoot([[maybe_unused]] const TObject * const objectPtr,
+                            [[maybe_unused]] const void * rootPtr) {
+    (call_ConnectFieldToRoot<typename gc_member_traits<decltype(TMembers)>::field_type>(
+        objectPtr->*TMembers, rootPtr), ...);
+  }
+
+  template <typename TObject>
+  static void disconnectFromRoot([[maybe_unused]] const TObject * const objectPtr,
+                                 [[maybe_unused]] const bool isRoot,
+                                 [[maybe_unused]] const void * rootPtr) {
+    (call_DisconnectFieldFromRoot<typename gc_member_traits<decltype(TMembers)>::field_type>(
+        objectPtr->*TMembers, isRoot, rootPtr), ...);
+  }
+};
+
+template <typename ... TFields>
+inline void call_ConnectFieldsToRoot(const std::tuple<TFields & ...> & fields, const void * rootPtr) {
+  std::apply([rootPtr](auto & ... field) {
+    (call_ConnectFieldToRoot<std::remove_cv_t<TFields>>(field, rootPtr), ...);
+  }, fields);
+}
+
+template <typename ... TFields>
+inline void call_DisconnectFieldsFromRoot(const std::tuple<TFields & ...> & fields,
+                                          const bool isRoot,
+                                          const void * rootPtr) {
+  std::apply([isRoot, rootPtr](auto & ... field) {
+    (call_DisconnectFieldFromRoot<std::remove_cv_t<TFields>>(field, isRoot, rootPtr), ...);
+  }, fields);
+}
+
+template <typename ... TBases, typename TDerived>
+inline void call_ConnectBasesToRoot(TDerived * derivedPtr, const void * rootPtr) {
+  (call_ConnectBaseToRoot<TBases>(derivedPtr, rootPtr), ...);
+}
+
+template <typename ... TBases, typename TDerived>
+inline void call_DisconnectBasesFromRoot(TDerived * derivedPtr, const bool isRoot, const void * rootPtr) {
+  (call_DisconnectBaseFromRoot<TBases>(derivedPtr, isRoot, rootPtr), ...);
+}
+
+#define GC_PP_UNPAREN(...) __VA_ARGS__
+
+/**
+ * @brief Declares traced fields of class without scripts/clang_extras.py, e.g. GC_TRACE_FIELDS(left_ptr_, right_ptr_)
+ * or GC_TRACE_FIELDS() for class without gc_ptr. Defines public connectToRoot() and disconnectFromRoot(),
+ * so members declared after it are public. Class should not be annotated with GC_TRACE at the same time
+ */
+#define GC_TRACE_FIELDS(...) \
+ public: \
+  void connectToRoot([[maybe_unused]] const void * rootPtr) const { \
+    memory::call_ConnectFieldsToRoot(std::tie(__VA_ARGS__), rootPtr); \
+  } \
+  void disconnectFromRoot([[maybe_unused]] const bool isRoot, [[maybe_unused]] const void * rootPtr) const { \
+    memory::call_DisconnectFieldsFromRoot(std::tie(__VA_ARGS__), isRoot, rootPtr); \
+  }
+
+/**
+ * @brief The same as GC_TRACE_FIELDS() for class whose bases contain gc_ptr,
+ * e.g. GC_TRACE_BASES_AND_FIELDS((Base, Mixin<int>), next_ptr_)
+ */
+#define GC_TRACE_BASES_AND_FIELDS(bases, ...) \
+ public: \
+  void connectToRoot([[maybe_unused]] const void * rootPtr) const { \
+    memory::call_ConnectBasesToRoot<GC_PP_UNPAREN bases>(this, rootPtr); \
+    memory::call_ConnectFieldsToRoot(std::tie(__VA_ARGS__), rootPtr); \
+  } \
+  void disconnectFromRoot([[maybe_unused]] const bool isRoot, [[maybe_unused]] const void * rootPtr) const { \
+    memory::call_DisconnectBasesFromRoot<GC_PP_UNPAREN bases>(this, isRoot, rootPtr); \
+    memory::call_DisconnectFieldsFromRoot(std::tie(__VA_ARGS__), isRoot, rootPtr); \
+  }
+
+template <typename TObject>
+class gc_ptr;
+
+/**
+ * @brief Borrowed handle to object of gc_ptr, it is not a root and does not take part in root propagation,
+ * so passing it to function costs as much as passing raw pointer. Object is kept alive by gc_ptr it was
+ * borrowed from, so gc_ref should be used only for parameters and be converted to gc_ptr when it is stored
+ */
+template <typename TObject>
+class gc_ref {
+ public:
+  gc_ref(const gc_ptr<TObject> & objectPtr) noexcept
+    : object_ptr_{objectPtr.object_ptr_}
+    , object_control_block_ptr_{objectPtr.object_control_block_ptr_} {
+  }
+
+  explicit operator bool() const noexcept {
+    return object_ptr_ != nullptr;
+  }
+
+  TObject & operator*() const noexcept {
+    return *object_ptr_;
+  }
+
+  TObject * operator->() const noexcept {
+    return object_ptr_;
+  }
+
+  TObject * get() const noexcept {
+    return object_ptr_;
+  }
+
+ private:
+  template <typename T>
+  friend class gc_ptr;
+
+  template <typename T>
+  friend class gc_vector;
+
+  TObject * object_ptr_;
+  gc_basic_control_block * object_control_block_ptr_;
+};
+
+template <typename TObject>
+class gc_ptr {
+  static_assert(!std::is_pointer<TObject>::value, "TObject should not be pointer type !!");
+  static_assert(!std::is_reference<TObject>::value, "TObject should not be reference type !!");
+
+ public:
+  gc_ptr()
+    : root_ptrs_{makeRootPtrs()} {
+    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
+  }
+
+  explicit gc_ptr(TObject * objectPtr)
+    : root_ptrs_{makeRootPtrs()} {
+    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
+    if constexpr (is_cycle_collected<TObject>::value) {
+      if (objectPtr != nullptr) {
+        assign(objectPtr, makeControlBlock(objectPtr));
+      }
+    } else if (objectPtr != nullptr) {
+      object_ptr_ = objectPtr;
+      object_control_block_ptr_ = makeControlBlock(objectPtr);
+      addAllRoots();
+    }
+  }
+
+  gc_ptr(const gc_ptr & gcPtr)
+    : root_ptrs_{makeRootPtrs()} {
+    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
+    this->operator=(gcPtr);
+  }
+
+  /**
+   * @brief Hands over root identity of root gc_ptr in O(1). Move is not noexcept, because it takes identity
+   * for moved-from gc_ptr and gc_ptr moved out of field of object becomes root that is propagated,
+   * both could allocate
+   */
+  gc_ptr(gc_ptr && gcPtr)
+    : root_ptrs_{makeRootPtrs()} {
+    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
+    this->operator=(std::move(gcPtr));
+  }
+
+  gc_ptr(const gc_ref<TObject> & objectRef)
+    : root_ptrs_{makeRootPtrs()} {
+    static_assert(has_use_gc_ptr<TObject>::value, "TObject should not be marked with GC_TRACE annotation !!");
+    this->operator=(objectRef);
+  }
+
+  ~gc_ptr() {
+    removeAllRoots();
+    if (is_root_ && !root_ptrs_.empty()) {
+      release_root_ptr(*root_ptrs_.begin());
+    }
+  }
+
+  template <typename T, typename TAllocator, typename ... TArgs>
+  friend gc_ptr<T> allocate_gc(const TAllocator & allocator, TArgs && ... args);
+
+  template <typename T>
+  friend class gc_vector;
+
+  template <typename T>
+  friend class gc_weak_ptr;
+
+  template <typename T>
+  friend class gc_ref;
+
+  friend class gc_region;
+
+  explicit operator bool() const noexcept {
+    return object_ptr_ != nullptr;
+  }
+
+  TObject & operator *() const {
+    return *object_ptr_;
+  }
+
+  TObject * operator->() const noexcept {
+    return object_ptr_;
+  }
+
+  TObject * get() const noexcept {
+    return object_ptr_;
+  }
+
+  void reset() {
+    removeAllRoots();
+  }
+
+  gc_ptr & operator=(TObject * const objectPtr) {
+    if (objectPtr == object_ptr_) {
+      return *this;
+    }
+    assign(objectPtr, objectPtr != nullptr ? makeControlBlock(objectPtr) : nullptr);
+    return *this;
+  }
+
+  gc_ptr & operator=(const gc_ptr & objectPtr) {
+    if (this != &objectPtr) {
+      assign(objectPtr.object_ptr_, objectPtr.object_control_block_ptr_);
+    }
+    return *this;
+  }
+
+  gc_ptr & operator=(const gc_ref<TObject> & objectRef) {
+    assign(objectRef.object_ptr_, objectRef.object_control_block_ptr_);
+    return *this;
+  }
+
+  gc_ptr & operator=(gc_ptr && objectPtr) {
+    if (this == &objectPtr) {
+      return *this;
+    }
+    if (object_control_block_ptr_ == objectPtr.object_control_block_ptr_) {
+      // NOTE(redra): Object is already reachable through this gc_ptr, so only what objectPtr brought is removed
+      objectPtr.removeAllRoots();
+      return *this;
+    }
+    if constexpr (is_cycle_collected<TObject>::value) {
+      auto * const oldObjectControlBlockPtr = objectControlBlockPtr();
+      object_ptr_ = objectPtr.object_ptr_;
+      object_control_block_ptr_ = objectPtr.object_control_block_ptr_;
+      objectPtr.object_ptr_ = nullptr;
+      objectPtr.object_control_block_ptr_ = nullptr;
+      if (oldObjectControlBlockPtr != nullptr) {
+        gc_cycle_collector::release(oldObjectControlBlockPtr);
+      }
+    } else if (objectPtr.is_root_) {
+      if (is_root_) {
+        // NOTE(redra): Root identity of objectPtr is handed over, so object graph is not touched at all
+        removeAllRoots();
+        root_ptrs_.swap(objectPtr.root_ptrs_);
+        object_ptr_ = objectPtr.object_ptr_;
+        object_control_block_ptr_ = objectPtr.object_control_block_ptr_;
+        objectPtr.object_ptr_ = nullptr;
+        objectPtr.object_control_block_ptr_ = nullptr;
+        if (object_control_block_ptr_ != nullptr) {
+          GC_HEAP_REGISTER_ROOT(*root_ptrs_.begin(), this, object_ptr_);
+        }
+      } else {
+        assign(objectPtr.object_ptr_, objectPtr.object_control_block_ptr_);
+        objectPtr.removeAllRoots();
+      }
+    } else {
+      // NOTE(redra): objectPtr is a member of some object that could be destroyed after releasing it,
+      //  so object is kept alive by own root before objectPtr is released
+      gc_ptr movedPtr{static_cast<const gc_ptr &>(objectPtr)};
+      objectPtr.removeAllRoots();
+      this->operator=(std::move(movedPtr));
+    }
+    return *this;
+  }
+
+  void connectToRoot(const void * rootPtr) const {
+    if constexpr (is_cycle_collected<TObject>::value) {
+      if (rootPtr == gc_cycle_collector::traceRootPtr() && object_control_block_ptr_ != nullptr) {
+        if (gc_cycle_collector::traceChild(objectControlBlockPtr())) {
+          object_ptr_ = nullptr;
+          object_control_block_ptr_ = nullptr;
+        }
+      }
+    } else if (rootPtr != gc_cycle_collector::traceRootPtr()) {
+      if (is_root_) {
+        becomeField(rootPtr);
+      }
+      root_ptrs_.insert(rootPtr);
+      pushAddRootPtr(rootPtr);
+    }
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    if constexpr (!is_cycle_collected<TObject>::value) {
+      if (is_root_) {
+        becomeField(rootPtr);
+      } else {
+        root_ptrs_.erase(rootPtr);
+        pushRemoveRootPtr(isRoot, rootPtr);
+      }
+      if (root_ptrs_.empty()) {
+        object_ptr_ = nullptr;
+        object_control_block_ptr_ = nullptr;
+      }
+    }
+  }
+
+ protected:
+  void assign(TObject * const objectPtr, gc_basic_control_block * const controlBlockPtr) {
+    if (controlBlockPtr == object_control_block_ptr_) {
+      // NOTE(redra): Reassignment of the same object changes neither roots nor reference counts
+      return;
+    }
+    if constexpr (is_cycle_collected<TObject>::value) {
+      if (controlBlockPtr != nullptr) {
+        gc_cycle_collector::acquire(static_cast<gc_cycle_control_block *>(controlBlockPtr));
+      }
+      auto * const oldObjectControlBlockPtr = objectControlBlockPtr();
+      object_ptr_ = objectPtr;
+      object_control_block_ptr_ = controlBlockPtr;
+      if (oldObjectControlBlockPtr != nullptr) {
+        gc_cycle_collector::release(oldObjectControlBlockPtr);
+      }
+    } else if (!is_root_ && gc_propagation_worklist::isRecording()) {
+      // NOTE(redra): Field propagates roots of its owner, so changes recorded by batch are applied before
+      //  they are read
+      gc_propagation_worklist::runUnbatched([this, objectPtr, controlBlockPtr] {
+        assignRoots(objectPtr, static_cast<gc_object_control_block *>(controlBlockPtr));
+      });
+    } else {
+      assignRoots(objectPtr, static_cast<gc_object_control_block *>(controlBlockPtr));
+    }
+  }
+
+  /**
+   * @brief Points gc_ptr to new object. Roots are added to new object before they are removed from old one,
+   * so objects reachable from both are never destroyed in between
+   */
+  void assignRoots(TObject * const objectPtr, gc_object_control_block * const controlBlockPtr) {
+    TObject * const oldObjectPtr = object_ptr_;
+    gc_object_control_block * const oldObjectControlBlockPtr = objectControlBlockPtr();
+    const void * oldRootPtr = nullptr;
+    if (is_root_ && oldObjectControlBlockPtr != nullptr) {
+      // NOTE(redra): Root gets new identity, old one is removed from the whole graph of old object
+      oldRootPtr = *root_ptrs_.begin();
+      GC_HEAP_UNREGISTER_ROOT(oldRootPtr);
+      root_ptrs_.erase(oldRootPtr);
+      root_ptrs_.insert(make_root_ptr());
+    }
+    object_ptr_ = objectPtr;
+    object_control_block_ptr_ = controlBlockPtr;
+    addAllRoots();
+    if (oldObjectControlBlockPtr != nullptr) {
+      const std::size_t baseSize = gc_propagation_worklist::size();
+      if (is_root_) {
+        pushRemoveRootPtr(oldObjectPtr, oldObjectControlBlockPtr, true, oldRootPtr);
+      } else {
+        for (auto rootRefPtr : root_ptrs_) {
+          pushRemoveRootPtr(oldObjectPtr, oldObjectControlBlockPtr, false, rootRefPtr);
+        }
+      }
+      gc_propagation_worklist::drain(baseSize);
+      if (oldRootPtr != nullptr) {
+        release_root_ptr(oldRootPtr);
+      }
+    }
+  }
+
+  void addAllRoots() {
+    if (object_control_block_ptr_ != nullptr) {
+      if (is_root_) {
+        GC_HEAP_REGISTER_ROOT(*root_ptrs_.begin(), this, object_ptr_);
+      }
+      const std::size_t baseSize = gc_propagation_worklist::size();
+      for (auto rootRefPtr : root_ptrs_) {
+        pushAddRootPtr(rootRefPtr);
+      }
+      gc_propagation_worklist::drain(baseSize);
+    }
+  }
+
+  void removeAllRoots() {
+    if constexpr (is_cycle_collected<TObject>::value) {
+      if (object_control_block_ptr_ != nullptr) {
+        auto * const controlBlockPtr = objectControlBlockPtr();
+        object_ptr_ = nullptr;
+        object_control_block_ptr_ = nullptr;
+        gc_cycle_collector::release(controlBlockPtr);
+      }
+    } else if (!is_root_ && object_control_block_ptr_ != nullptr && gc_propagation_worklist::isRecording()) {
+      gc_propagation_worklist::runUnbatched([this] {
+        removeAllRoots();
+      });
+    } else if (object_control_block_ptr_ != nullptr) {
+      if (is_root_) {
+        GC_HEAP_UNREGISTER_ROOT(*root_ptrs_.begin());
+      }
+      const std::size_t baseSize = gc_propagation_worklist::size();
+      for (auto rootRefPtr : root_ptrs_) {
+        pushRemoveRootPtr(object_ptr_, objectControlBlockPtr(), is_root_, rootRefPtr);
+      }
+      object_ptr_ = nullptr;
+      object_control_block_ptr_ = nullptr;
+      gc_propagation_worklist::drain(baseSize);
+    }
+  }
+
+  /**
+   * @brief Turns root that is visited by its owner into field that is reachable from roots of owner except rootPtr.
+   * Own root is removed by task that is pushed first, so it runs after object got roots of owner
+   */
+  void becomeField(const void * rootPtr) const {
+    const void * selfRootPtr = *root_ptrs_.begin();
+    GC_HEAP_UNREGISTER_ROOT(selfRootPtr);
+    is_root_ = false;
+    root_ptrs_.erase(selfRootPtr);
+    pushRemoveRootPtr(true, selfRootPtr);
+    release_root_ptr(selfRootPtr);
+    if (const gc_root_table<> * ownerRootPtrs = gc_propagation_worklist::ownerRoots()) {
+      for (const auto & rootCount : *ownerRootPtrs) {
+        const void * ownerRootPtr = rootCount.rootPtr();
+        // NOTE(redra): Own root could come back to owner through cycle
+        if (ownerRootPtr != rootPtr && ownerRootPtr != selfRootPtr && root_ptrs_.insert(ownerRootPtr)) {
+          pushAddRootPtr(ownerRootPtr);
+        }
+      }
+    }
+  }
+
+  void pushAddRootPtr(const void * rootPtr) const {
+    if (object_control_block_ptr_ != nullptr) {
+      gc_propagation_worklist::push({&addRootPtrToObject, object_ptr_, objectControlBlockPtr(), rootPtr, false});
+    }
+  }
+
+  void pushRemoveRootPtr(const bool isRoot, const void * rootPtr) const {
+    if (object_control_block_ptr_ != nullptr) {
+      pushRemoveRootPtr(object_ptr_, objectControlBlockPtr(), isRoot, rootPtr);
+    }
+  }
+
+  static void pushRemoveRootPtr(TObject * const objectPtr,
+                                gc_object_control_block * const objectControlBlockPtr,
+                                const bool isRoot,
+                                const void * rootPtr) {
+    gc_propagation_worklist::push({&removeRootPtrFromObject, objectPtr, objectControlBlockPtr, rootPtr, isRoot, true});
+  }
+
+  static void addRootPtrToObject(const gc_propagation_task & task) {
+    task.control_block_ptr_->addRootPtr(task.root_ptr_, [&task](const gc_root_table<> * rootPtrs) {
+      if constexpr (has_use_gc_ptr<TObject>::value) {
+        GC_STATS_ADD(connect_calls_, 1);
+        connectObject(static_cast<TObject *>(task.object_ptr_), task.root_ptr_, rootPtrs);
+      }
+    });
+  }
+
+  /**
+   * @brief Connects fields of object, roots of object are seen by fields that are still roots.
+   * connectToRoot() of fields only pushes tasks, so roots are not seen by other objects
+   */
+  static void connectObject(TObject * const objectPtr, const void * rootPtr, const gc_root_table<> * rootPtrs) {
+    const gc_root_table<> *& ownerRootPtrs = gc_propagation_worklist::ownerRoots();
+    ownerRootPtrs = rootPtrs;
+    objectPtr->connectToRoot(rootPtr);
+    ownerRootPtrs = nullptr;
+  }
+
+  /**
+   * @brief Removes root from object and enqueues removal of root from its fields.
+   * Object that lost its last root is deleted when drain is done, because removal could come back
+   * to the object through cycle
+   */
+  static void removeRootPtrFromObject(const gc_propagation_task & task) {
+    const auto disconnect = [&task](const gc_root_table<> * rootPtrs) {
+      if constexpr (has_use_gc_ptr<TObject>::value) {
+        GC_STATS_ADD(disconnect_calls_, 1);
+        const gc_root_table<> *& ownerRootPtrs = gc_propagation_worklist::ownerRoots();
+        ownerRootPtrs = rootPtrs;
+        static_cast<TObject *>(task.object_ptr_)->disconnectFromRoot(task.is_root_, task.root_ptr_);
+        ownerRootPtrs = nullptr;
+      }
+    };
+    bool isNoRoots;
+    // NOTE(redra): Weak anchor is locked before control block by gc_weak_ptr::lock(), so it is expired
+    //  after lock_object_ is released
+    if (task.control_block_ptr_->removeRootPtr(task.is_root_, task.root_ptr_, isNoRoots, disconnect) && isNoRoots) {
+      task.control_block_ptr_->expireWeakAnchor();
+      gc_propagation_worklist::pushGarbage(task.object_ptr_, task.control_block_ptr_);
+    }
+  }
+
+  /**
+   * @brief Creates root to object of weak anchor if object is still reachable.
+   * Root is propagated right away even inside of gc::batch_scope, so it keeps reachable subgraph alive
+   */
+  static gc_ptr lockWeakAnchor(gc_weak_anchor * const anchorPtr) {
+    gc_ptr objectPtr;
+    gc_propagation_worklist::runUnbatched([anchorPtr, &objectPtr] {
+      objectPtr.lockAnchor(anchorPtr);
+    });
+    return objectPtr;
+  }
+
+  void lockAnchor(gc_weak_anchor * const anchorPtr) {
+    const void * rootPtr = *root_ptrs_.begin();
+    const std::size_t baseSize = gc_propagation_worklist::size();
+    {
+      std::lock_guard<gc_lock_type> lock{anchorPtr->lock_object_};
+      auto lockedObjectPtr = static_cast<TObject *>(anchorPtr->object_ptr_.load(std::memory_order_acquire));
+      if (lockedObjectPtr == nullptr ||
+          !anchorPtr->control_block_ptr_->tryAddRootPtr(rootPtr, [lockedObjectPtr, rootPtr](
+              const gc_root_table<> * rootPtrs) {
+            if constexpr (has_use_gc_ptr<TObject>::value) {
+              connectObject(lockedObjectPtr, rootPtr, rootPtrs);
+            }
+          })) {
+        return;
+      }
+      object_ptr_ = lockedObjectPtr;
+      object_control_block_ptr_ = anchorPtr->control_block_ptr_;
+    }
+    GC_HEAP_REGISTER_ROOT(rootPtr, this, object_ptr_);
+    gc_propagation_worklist::drain(baseSize);
+  }
+
+  static gc_root_set<> makeRootPtrs() {
+    if constexpr (is_cycle_collected<TObject>::value) {
+      return gc_root_set<>{};
+    } else {
+      return gc_root_set<>{make_root_ptr()};
+    }
+  }
+
+  auto objectControlBlockPtr() const noexcept {
+    return static_cast<gc_control_block_type<TObject> *>(object_control_block_ptr_);
+  }
+
+  /**
+   * @brief Control block embedded by gc_enable, object could already be owned by other gc_ptr
+   */
+  static auto intrusiveControlBlock(TObject * const objectPtr) noexcept {
+    using enable_type = gc_enable<typename gc_reclamation_policy<TObject>::type>;
+    return &static_cast<const enable_type *>(objectPtr)->gc_control_block_;
+  }
+
+  static gc_basic_control_block * makeControlBlock([[maybe_unused]] TObject * const objectPtr) {
+    if constexpr (is_gc_enabled<TObject>::value) {
+      auto controlBlockPtr = intrusiveControlBlock(objectPtr);
+      if (controlBlockPtr->delete_object_ == nullptr) {
+        GC_STATS_ADD(created_objects_, 1);
+        if constexpr (is_cycle_collected<TObject>::value) {
+          controlBlockPtr->object_ptr_ = objectPtr;
+          controlBlockPtr->trace_object_ = &traceObject;
+        }
+        if constexpr (!is_cycle_collected<TObject>::value) {
+          GC_HEAP_REGISTER(objectPtr, controlBlockPtr);
+        }
+        controlBlockPtr->delete_object_ = &deleteIntrusiveObject;
+      }
+      return controlBlockPtr;
+    } else if constexpr (is_cycle_collected<TObject>::value) {
+      GC_STATS_ADD(created_objects_, 1);
+      GC_STATS_ADD(control_block_allocations_, 1);
+      auto controlBlockPtr = new gc_cycle_control_block{};
+      controlBlockPtr->object_ptr_ = objectPtr;
+      controlBlockPtr->trace_object_ = &traceObject;
+      controlBlockPtr->delete_object_ = &deleteObject;
+      return controlBlockPtr;
+    } else {
+      GC_STATS_ADD(created_objects_, 1);
+      GC_STATS_ADD(control_block_allocations_, 1);
+      auto controlBlockPtr = new gc_object_control_block{};
+      controlBlockPtr->delete_object_ = &deleteObject;
+      GC_HEAP_REGISTER(objectPtr, controlBlockPtr);
+      return controlBlockPtr;
+    }
+  }
+
+  static void traceObject(const void * const objectPtr) {
+    static_cast<const TObject *>(objectPtr)->connectToRoot(gc_cycle_collector::traceRootPtr());
+  }
+
+  static void deleteObject(gc_cycle_control_block * const controlBlockPtr) {
+    GC_STATS_ADD(destroyed_objects_, 1);
+    delete static_cast<TObject *>(controlBlockPtr->object_ptr_);
+    delete controlBlockPtr;
+  }
+
+  static void deleteObject(void * const objectPtr, gc_object_control_block * const controlBlockPtr) {
+    GC_STATS_ADD(destroyed_objects_, 1);
+    GC_HEAP_UNREGISTER(controlBlockPtr);
+    delete static_cast<TObject *>(objectPtr);
+    delete controlBlockPtr;
+  }
+
+  // NOTE(redra): Control block is destroyed together with object
+  static void deleteIntrusiveObject(gc_cycle_control_block * const controlBlockPtr) {
+    GC_STATS_ADD(destroyed_objects_, 1);
+    delete static_cast<TObject *>(controlBlockPtr->object_ptr_);
+  }
+
+  static void deleteIntrusiveObject(void * const objectPtr,
+                                    [[maybe_unused]] gc_object_control_block * const controlBlockPtr) {
+    GC_STATS_ADD(destroyed_objects_, 1);
+    GC_HEAP_UNREGISTER(controlBlockPtr);
+    delete static_cast<TObject *>(objectPtr);
+  }
+
+  template <typename TAllocator>
+  static void deleteAllocatedStorage(gc_cycle_control_block * const controlBlockPtr) {
+    destroyAllocatedStorage<TAllocator>(controlBlockPtr->object_ptr_, controlBlockPtr);
+  }
+
+  template <typename TAllocator>
+  static void deleteAllocatedStorage(void * const objectPtr, gc_object_control_block * const controlBlockPtr) {
+    GC_HEAP_UNREGISTER(controlBlockPtr);
+    destroyAllocatedStorage<TAllocator>(objectPtr, controlBlockPtr);
+  }
+
+  /**
+   * @brief Destroys storage created by allocate_gc() and releases it to allocator it was allocated from.
+   * Storage starts with object or with control block depending on its layout
+   */
+  template <typename TAllocator>
+  static void destroyAllocatedStorage(void * const objectPtr, void * const controlBlockPtr) {
+    using storage_type = gc_allocated_storage_type<TObject, TAllocator>;
+    using storage_allocator_type = typename std::allocator_traits<TAllocator>::template rebind_alloc<storage_type>;
+    auto storagePtr =
+        reinterpret_cast<storage_type *>(storage_type::kIsControlBlockFirst ? controlBlockPtr : objectPtr);
+    GC_STATS_ADD(destroyed_objects_, 1);
+    storage_allocator_type storageAllocator = [storagePtr] {
+      if constexpr (std::allocator_traits<TAllocator>::is_always_equal::value) {
+        return storage_allocator_type{};
+      } else {
+        return storage_allocator_type{storagePtr->allocator_};
+      }
+    }();
+    storagePtr->~storage_type();
+    std::allocator_traits<storage_allocator_type>::deallocate(storageAllocator, storagePtr, 1);
+  }
+
+  mutable bool is_root_ = true;
+  mutable gc_root_set<> root_ptrs_;
+  mutable TObject * object_ptr_ = nullptr;
+  mutable gc_basic_control_block * object_control_block_ptr_ = nullptr;
+};
+
+/**
+ * @brief Creates object together with its control block in single block taken from allocator,
+ * block is released back to copy of the same allocator when object is destroyed.
+ * Object is constructed in place from forwarded arguments, see gc_construct_object()
+ */
+template <typename TObject, typename TAllocator, typename ... TArgs>
+gc_ptr<TObject> allocate_gc(const TAllocator & allocator, TArgs && ... args) {
+  using storage_type = gc_allocated_storage_type<TObject, TAllocator>;
+  using storage_allocator_type = typename std::allocator_traits<TAllocator>::template rebind_alloc<storage_type>;
+  using storage_allocator_traits = std::allocator_traits<storage_allocator_type>;
+  constexpr bool kIsAlwaysEqual = std::allocator_traits<TAllocator>::is_always_equal::value;
+
+  gc_ptr<TObject> ptr{};
+  storage_allocator_type storageAllocator{allocator};
+  storage_type * const storagePtr = storage_allocator_traits::allocate(storageAllocator, 1);
+  try {
+    if constexpr (kIsAlwaysEqual) {
+      new (storagePtr) storage_type(std::in_place, std::forward<TArgs>(args)...);
+    } else {
+      new (storagePtr) storage_type(allocator, std::in_place, std::forward<TArgs>(args)...);
+    }
+  } catch (...) {
+    storage_allocator_traits::deallocate(storageAllocator, storagePtr, 1);
+    throw;
+  }
+  GC_STATS_ADD(created_objects_, 1);
+  auto controlBlockPtr = [storagePtr] {
+    if constexpr (is_gc_enabled<TObject>::value) {
+      return gc_ptr<TObject>::intrusiveControlBlock(&storagePtr->object_);
+    } else {
+      return &storagePtr->control_block_;
+    }
+  }();
+  if constexpr (is_cycle_collected<TObject>::value) {
+    controlBlockPtr->object_ptr_ = &storagePtr->object_;
+    controlBlockPtr->trace_object_ = &gc_ptr<TObject>::traceObject;
+    controlBlockPtr->delete_object_ = &gc_ptr<TObject>::template deleteAllocatedStorage<TAllocator>;
+    ptr.assign(&storagePtr->object_, controlBlockPtr);
+  } else {
+    controlBlockPtr->delete_object_ = &gc_ptr<TObject>::template deleteAllocatedStorage<TAllocator>;
+    GC_HEAP_REGISTER(&storagePtr->object_, controlBlockPtr);
+    ptr.object_ptr_ = &storagePtr->object_;
+    ptr.object_control_block_ptr_ = controlBlockPtr;
+    ptr.addAllRoots();
+  }
+  return ptr;
+}
+
+template <typename TObject, typename ... TArgs>
+gc_ptr<TObject> gc_region::make(TArgs && ... args) {
+  using storage_type = gc_allocated_storage_type<TObject, gc_region_allocator<TObject>>;
+  auto ptr = allocate_gc<TObject>(gc_region_allocator<TObject>{*this}, std::forward<TArgs>(args)...);
+  auto controlBlockPtr = static_cast<gc_object_control_block *>(ptr.object_control_block_ptr_);
+  void * const storagePtr = storage_type::kIsControlBlockFirst ? static_cast<void *>(controlBlockPtr)
+                                                               : static_cast<void *>(ptr.object_ptr_);
+  gc_region_block * const blockPtr = blockOf(storagePtr);
+  blockPtr->object_ptr_ = ptr.object_ptr_;
+  blockPtr->control_block_ptr_ = controlBlockPtr;
+  blockPtr->is_trivially_destructible_ = std::is_trivially_destructible<TObject>::value;
+  return ptr;
+}
+
+template <typename TObject>
+gc_ptr<TObject> & gc_region::keep(gc_ptr<TObject> ptr) {
+  void * const rootPtr = allocate(sizeof(gc_ptr<TObject>), alignof(gc_ptr<TObject>));
+  roots_.reserve(roots_.size() + 1);
+  auto keptPtr = new (rootPtr) gc_ptr<TObject>{std::move(ptr)};
+  roots_.push_back({rootPtr, [](void * const keptRootPtr) {
+    static_cast<gc_ptr<TObject> *>(keptRootPtr)->~gc_ptr();
+  }});
+  return *keptPtr;
+}
+
+/**
+ * @brief Creates object together with its control block, in gc_region of this thread if there is one
+ */
+template <typename TObject, typename ... TArgs>
+gc_ptr<TObject> make_gc(TArgs && ... args) {
+  if constexpr (!is_cycle_collected<TObject>::value) {
+    if (gc_region * const regionPtr = gc_region::current()) {
+      return regionPtr->make<TObject>(std::forward<TArgs>(args)...);
+    }
+  }
+  return allocate_gc<TObject>(std::allocator<TObject>{}, std::forward<TArgs>(args)...);
+}
+
+/**
+ * @brief Contiguous vector of pointers to objects that keeps one root set for all elements instead of root set
+ * per gc_ptr, so root is propagated by one pass over elements and push_back(), pop_back() and clear()
+ * update control blocks of elements in batch. Elements are objects and their control blocks only
+ */
+template <typename TObject>
+class gc_vector {
+  struct gc_element {
+    TObject * object_ptr_;
+    gc_object_control_block * control_block_ptr_;
+  };
+
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = TObject *;
+    using difference_type = std::ptrdiff_t;
+    using pointer = TObject * const *;
+    using reference = TObject *;
+
+    explicit const_iterator(const gc_element * elementPtr) noexcept
+      : element_ptr_{elementPtr} {
+    }
+
+    TObject * operator*() const noexcept {
+      return element_ptr_->object_ptr_;
+    }
+
+    TObject * operator[](const difference_type index) const noexcept {
+      return element_ptr_[index].object_ptr_;
+    }
+
+    const_iterator & operator++() noexcept {
+      ++element_ptr_;
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept {
+      return const_iterator{element_ptr_++};
+    }
+
+    const_iterator & operator--() noexcept {
+      --element_ptr_;
+      return *this;
+    }
+
+    const_iterator operator--(int) noexcept {
+      return const_iterator{element_ptr_--};
+    }
+
+    const_iterator & operator+=(const difference_type offset) noexcept {
+      element_ptr_ += offset;
+      return *this;
+    }
+
+    const_iterator operator+(const difference_type offset) const noexcept {
+      return const_iterator{element_ptr_ + offset};
+    }
+
+    const_iterator & operator-=(const difference_type offset) noexcept {
+      element_ptr_ -= offset;
+      return *this;
+    }
+
+    const_iterator operator-(const difference_type offset) const noexcept {
+      return const_iterator{element_ptr_ - offset};
+    }
+
+    difference_type operator-(const const_iterator & iterator) const noexcept {
+      return element_ptr_ - iterator.element_ptr_;
+    }
+
+    bool operator==(const const_iterator & iterator) const noexcept {
+      return element_ptr_ == iterator.element_ptr_;
+    }
+
+    bool operator!=(const const_iterator & iterator) const noexcept {
+      return element_ptr_ != iterator.element_ptr_;
+    }
+
+    bool operator<(const const_iterator & iterator) const noexcept {
+      return element_ptr_ < iterator.element_ptr_;
+    }
+
+    bool operator>(const const_iterator & iterator) const noexcept {
+      return element_ptr_ > iterator.element_ptr_;
+    }
+
+    bool operator<=(const const_iterator & iterator) const noexcept {
+      return element_ptr_ <= iterator.element_ptr_;
+    }
+
+    bool operator>=(const const_iterator & iterator) const noexcept {
+      return element_ptr_ >= iterator.element_ptr_;
+    }
+
+    friend const_iterator operator+(const difference_type offset, const const_iterator & iterator) noexcept {
+      return iterator + offset;
+    }
+
+   private:
+    const gc_element * element_ptr_;
+  };
+
+  using value_type = TObject *;
+  using size_type = std::size_t;
+  using iterator = const_iterator;
+
+  gc_vector()
+    : root_ptrs_{make_root_ptr()} {
+    static_assert(!is_cycle_collected<TObject>::value, "gc_vector supports only gc_root_propagation policy !!");
+  }
+
+  gc_vector(const gc_vector & vector)
+    : root_ptrs_{make_root_ptr()}
+    , elements_{vector.elements_} {
+    static_assert(!is_cycle_collected<TObject>::value, "gc_vector supports only gc_root_propagation policy !!");
+    addAllRoots(0);
+  }
+
+  /**
+   * @brief Move is not noexcept, because moved-from vector takes new identity and vector moved out of field
+   * of object copies elements, both could allocate
+   */
+  gc_vector(gc_vector && vector)
+    : root_ptrs_{make_root_ptr()} {
+    static_assert(!is_cycle_collected<TObject>::value, "gc_vector supports only gc_root_propagation policy !!");
+    this->operator=(std::move(vector));
+  }
+
+  ~gc_vector() {
+    std::vector<gc_element> oldElements;
+    elements_.swap(oldElements);
+    if (!oldElements.empty()) {
+      updateElements([this, &oldElements] {
+        removeAllRoots(oldElements, is_root_);
+      });
+    }
+    if (is_root_) {
+      release_root_ptr(*root_ptrs_.begin());
+    }
+  }
+
+  gc_vector & operator=(const gc_vector & vector) {
+    if (this != &vector) {
+      updateElements([this, &vector] {
+        assignElements(vector);
+      });
+    }
+    return *this;
+  }
+
+  gc_vector & operator=(gc_vector && vector) {
+    if (this == &vector) {
+      return *this;
+    }
+    if (is_root_ && vector.is_root_) {
+      // NOTE(redra): Root identity of vector is handed over together with elements, so they are not touched
+      clear();
+      root_ptrs_.swap(vector.root_ptrs_);
+      elements_.swap(vector.elements_);
+      if (!elements_.empty()) {
+        GC_HEAP_REGISTER_ROOT(*root_ptrs_.begin(), this, nullptr);
+      }
+    } else {
+      this->operator=(static_cast<const gc_vector &>(vector));
+      vector.clear();
+    }
+    return *this;
+  }
+
+  TObject * operator[](const size_type index) const noexcept {
+    return elements_[index].object_ptr_;
+  }
+
+  const_iterator begin() const noexcept {
+    return const_iterator{elements_.data()};
+  }
+
+  const_iterator end() const noexcept {
+    return const_iterator{elements_.data() + elements_.size()};
+  }
+
+  size_type size() const noexcept {
+    return elements_.size();
+  }
+
+  bool empty() const noexcept {
+    return elements_.empty();
+  }
+
+  void reserve(const size_type capacity) {
+    elements_.reserve(capacity);
+  }
+
+  void push_back(const gc_ref<TObject> & objectRef) {
+    updateElements([this, &objectRef] {
+      elements_.push_back(makeElement(objectRef));
+      addAllRoots(elements_.size() - 1);
+    });
+  }
+
+  void set(const size_type index, const gc_ref<TObject> & objectRef) {
+    if (elements_[index].control_block_ptr_ == objectRef.object_control_block_ptr_) {
+      return;
+    }
+    updateElements([this, index, &objectRef] {
+      const gc_element oldElement = elements_[index];
+      elements_[index] = makeElement(objectRef);
+      addAllRoots(index, index + 1);
+      removeAllRoots(&oldElement, &oldElement + 1, false);
+    });
+  }
+
+  void pop_back() {
+    updateElements([this] {
+      const gc_element oldElement = elements_.back();
+      elements_.pop_back();
+      removeAllRoots(&oldElement, &oldElement + 1, false);
+    });
+  }
+
+  /**
+   * @brief Own root of vector is removed from the whole graph of elements regardless of count,
+   * because no element refers to it any more. Root vector takes new identity after that,
+   * so erased root is never added again
+   */
+  void clear() {
+    if (elements_.empty()) {
+      return;
+    }
+    updateElements([this] {
+      std::vector<gc_element> oldElements;
+      elements_.swap(oldElements);
+      removeAllRoots(oldElements, is_root_);
+      if (is_root_) {
+        const void * oldRootPtr = *root_ptrs_.begin();
+        root_ptrs_.erase(oldRootPtr);
+        root_ptrs_.insert(make_root_ptr());
+        release_root_ptr(oldRootPtr);
+      }
+    });
+  }
+
+  void connectToRoot(const void * rootPtr) const {
+    if (is_root_) {
+      becomeField(rootPtr);
+    }
+    root_ptrs_.insert(rootPtr);
+    for (const auto & element : elements_) {
+      pushAddRootPtr(element, rootPtr);
+    }
+  }
+
+  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {
+    if (is_root_) {
+      becomeField(rootPtr);
+    } else {
+      root_ptrs_.erase(rootPtr);
+      pushRemoveRootPtr(elements_.data(), elements_.data() + elements_.size(), isRoot, rootPtr);
+    }
+    if (root_ptrs_.empty()) {
+      elements_.clear();
+    }
+  }
+
+ private:
+  /**
+   * @brief Vector stored inside of object propagates roots of its owner, so changes recorded by batch are applied
+   * before elements or roots of vector are changed
+   */
+  template <typename TUpdate>
+  void updateElements(TUpdate && update) {
+    if (!is_root_ && gc_propagation_worklist::isRecording()) {
+      gc_propagation_worklist::runUnbatched(update);
+    } else {
+      update();
+    }
+  }
+
+  void assignElements(const gc_vector & vector) {
+    // NOTE(redra): Roots are added to new elements before they are removed from old ones,
+    //  so objects that are in both are never destroyed in between
+    std::vector<gc_element> oldElements{vector.elements_};
+    elements_.swap(oldElements);
+    if (is_root_) {
+      // NOTE(redra): Root gets new identity, old one is removed from the whole graph of old elements
+      const void * oldRootPtr = *root_ptrs_.begin();
+      GC_HEAP_UNREGISTER_ROOT(oldRootPtr);
+      root_ptrs_.erase(oldRootPtr);
+      root_ptrs_.insert(make_root_ptr());
+      addAllRoots(0);
+      const std::size_t baseSize = gc_propagation_worklist::size();
+      pushRemoveRootPtr(oldElements.data(), oldElements.data() + oldElements.size(), true, oldRootPtr);
+      gc_propagation_worklist::drain(baseSize);
+      release_root_ptr(oldRootPtr);
+    } else {
+      addAllRoots(0);
+      removeAllRoots(oldElements, false);
+    }
+  }
+
+  static gc_element makeElement(const gc_ref<TObject> & objectRef) noexcept {
+    return {objectRef.object_ptr_, static_cast<gc_object_control_block *>(objectRef.object_control_block_ptr_)};
+  }
+
+  void addAllRoots(const size_type first) {
+    addAllRoots(first, elements_.size());
+  }
+
+  void addAllRoots(const size_type first, const size_type last) {
+    if (is_root_ && first != last) {
+      GC_HEAP_REGISTER_ROOT(*root_ptrs_.begin(), this, nullptr);
+    }
+    const std::size_t baseSize = gc_propagation_worklist::size();
+    for (auto rootRefPtr : root_ptrs_) {
+      for (size_type i = first; i < last; ++i) {
+        pushAddRootPtr(elements_[i], rootRefPtr);
+      }
+    }
+    gc_propagation_worklist::drain(baseSize);
+  }
+
+  void removeAllRoots(const std::vector<gc_element> & oldElements, const bool isRoot) {
+    removeAllRoots(oldElements.data(), oldElements.data() + oldElements.size(), isRoot);
+  }
+
+  /**
+   * @param isRoot true only if no element refers to own root of vector any more. Removed element could still be
+   * reachable through remaining elements, so otherwise one gc_ptr that brought roots to it is subtracted
+   */
+  void removeAllRoots(const gc_element * first, const gc_element * last, const bool isRoot) {
+    if (is_root_ && elements_.empty()) {
+      GC_HEAP_UNREGISTER_ROOT(*root_ptrs_.begin());
+    }
+    const std::size_t baseSize = gc_propagation_worklist::size();
+    for (auto rootRefPtr : root_ptrs_) {
+      pushRemoveRootPtr(first, last, isRoot, rootRefPtr);
+    }
+    gc_propagation_worklist::drain(baseSize);
+  }
+
+  /**
+   * @brief The same as gc_ptr::becomeField() for all elements, own root is removed by tasks that are pushed first
+   */
+  void becomeField(const void * rootPtr) const {
+    const void * selfRootPtr = *root_ptrs_.begin();
+    GC_HEAP_UNREGISTER_ROOT(selfRootPtr);
+    is_root_ = false;
+    root_ptrs_.erase(selfRootPtr);
+    pushRemoveRootPtr(elements_.data(), elements_.data() + elements_.size(), true, selfRootPtr);
+    release_root_ptr(selfRootPtr);
+    if (const gc_root_table<> * ownerRootPtrs = gc_propagation_worklist::ownerRoots()) {
+      for (const auto & rootCount : *ownerRootPtrs) {
+        const void * ownerRootPtr = rootCount.rootPtr();
+        if (ownerRootPtr != rootPtr && ownerRootPtr != selfRootPtr && root_ptrs_.insert(ownerRootPtr)) {
+          for (const auto & element : elements_) {
+            pushAddRootPtr(element, ownerRootPtr);
+          }
+        }
+      }
+    }
+  }
+
+  static void pushAddRootPtr(const gc_element & element, const void * rootPtr) {
+    if (element.control_block_ptr_ != nullptr) {
+      gc_propagation_worklist::push({&gc_ptr<TObject>::addRootPtrToObject,
+                                     element.object_ptr_, element.control_block_ptr_, rootPtr, false});
+    }
+  }
+
+  static void pushRemoveRootPtr(const gc_element * first, const gc_element * last,
+                                const bool isRoot, const void * rootPtr) {
+    for (auto elementPtr = first; elementPtr != last; ++elementPtr) {
+      pushRemoveRootPtr(*elementPtr, isRoot, rootPtr);
+    }
+  }
+
+  static void pushRemoveRootPtr(const gc_element & element, const bool isRoot, const void * rootPtr) {
+    if (element.control_block_ptr_ != nullptr) {
+      gc_ptr<TObject>::pushRemoveRootPtr(element.object_ptr_, element.control_block_ptr_, isRoot, rootPtr);
+    }
+  }
+
+  mutable bool is_root_ = true;
+  mutable gc_root_set<> root_ptrs_;
+  mutable std::vector<gc_element> elements_;
+};
+
+/**
+ * @brief Non-owning pointer to object of gc_root_propagation policy. It does not take part in root propagation,
+ * so it is suitable for back references, expired() costs one atomic load and lock() returns gc_ptr
+ * only while object is reachable
+ */
+template <typename TObject>
+class gc_weak_ptr {
+ public:
+  gc_weak_ptr() noexcept = default;
+
+  gc_weak_ptr(const gc_ptr<TObject> & objectPtr) {
+    static_assert(!is_cycle_collected<TObject>::value, "gc_weak_ptr supports only gc_root_propagation policy !!");
+    if (objectPtr.object_control_block_ptr_ != nullptr) {
+      anchor_ptr_ = objectPtr.objectControlBlockPtr()->acquireWeakAnchor(objectPtr.object_ptr_);
+    }
+  }
+
+  gc_weak_ptr(const gc_weak_ptr & weakPtr) noexcept
+    : anchor_ptr_{weakPtr.anchor_ptr_} {
+    if (anchor_ptr_ != nullptr) {
+      gc_weak_anchor::acquire(anchor_ptr_);
+    }
+  }
+
+  gc_weak_ptr(gc_weak_ptr && weakPtr) noexcept
+    : anchor_ptr_{weakPtr.anchor_ptr_} {
+    weakPtr.anchor_ptr_ = nullptr;
+  }
+
+  ~gc_weak_ptr() {
+    reset();
+  }
+
+  gc_weak_ptr & operator=(const gc_weak_ptr & weakPtr) noexcept {
+    gc_weak_ptr{weakPtr}.swap(*this);
+    return *this;
+  }
+
+  gc_weak_ptr & operator=(gc_weak_ptr && weakPtr) noexcept {
+    gc_weak_ptr{std::move(weakPtr)}.swap(*this);
+    return *this;
+  }
+
+  gc_weak_ptr & operator=(const gc_ptr<TObject> & objectPtr) {
+    gc_weak_ptr{objectPtr}.swap(*this);
+    return *this;
+  }
+
+  bool expired() const noexcept {
+    return anchor_ptr_ == nullptr || anchor_ptr_->object_ptr_.load(std::memory_order_acquire) == nullptr;
+  }
+
+  /**
+   * @brief Returned gc_ptr is a new root, so like copy of gc_ptr it is propagated through the whole subgraph
+   * reachable from object and removed from it again when gc_ptr is destroyed, cost is O(reachable subgraph).
+   * Object reachable from single root is moved to root table under its lock until one of two roots is gone
+   */
+  gc_ptr<TObject> lock() const {
+    if (anchor_ptr_ == nullptr) {
+      return gc_ptr<TObject>{};
+    }
+    return gc_ptr<TObject>::lockWeakAnchor(anchor_ptr_);
+  }
+
+  void reset() noexcept {
+    if (anchor_ptr_ != nullptr) {
+      gc_weak_anchor::release(anchor_ptr_);
+      anchor_ptr_ = nullptr;
+    }
+  }
+
+  void swap(gc_weak_ptr & weakPtr) noexcept {
+    std::swap(anchor_ptr_, weakPtr.anchor_ptr_);
+  }
+
+ private:
+  gc_weak_anchor * anchor_ptr_ = nullptr;
+};
+
+/**
+ * @brief gc_ptr that could be loaded, stored, exchanged and compared-and-exchanged by several threads at once
+ * with the same guarantees as std::atomic<std::shared_ptr<T>>. atomic_gc_ptr is root of object it points to,
+ * operations are done under GC_LOCK_TYPE lock, so gc_ptr returned by load() gets its root in the whole reachable
+ * subgraph before other thread could release object. Store and exchange only swap root identities under lock,
+ * replaced object is released after lock.
+ * NOTE: atomic_gc_ptr is not traced as field, so cycle through object that contains it is not destroyed
+ */
+template <typename TObject>
+class atomic_gc_ptr {
+ public:
+  using value_type = gc_ptr<TObject>;
+
+  static constexpr bool is_always_lock_free = false;
+
+  atomic_gc_ptr() = default;
+
+  atomic_gc_ptr(gc_ptr<TObject> objectPtr)
+    : object_ptr_{std::move(objectPtr)} {
+  }
+
+  atomic_gc_ptr(const atomic_gc_ptr &) = delete;
+  atomic_gc_ptr & operator=(const atomic_gc_ptr &) = delete;
+
+  void operator=(gc_ptr<TObject> objectPtr) {
+    store(std::move(objectPtr));
+  }
+
+  operator gc_ptr<TObject>() const {
+    return load();
+  }
+
+  bool is_lock_free() const noexcept {
+    return false;
+  }
+
+  gc_ptr<TObject> load(std::memory_order = std::memory_order_seq_cst) const {
+    gc_ptr<TObject> objectPtr;
+    gc_propagation_worklist::runUnbatched([this, &objectPtr] {
+      std::lock_guard<gc_lock_type> lock{lock_object_};
+      objectPtr = object_ptr_;
+    });
+    return objectPtr;
+  }
+
+  void store(gc_ptr<TObject> objectPtr, std::memory_order = std::memory_order_seq_cst) {
+    exchange(std::move(objectPtr));
+  }
+
+  gc_ptr<TObject> exchange(gc_ptr<TObject> objectPtr, std::memory_order = std::memory_order_seq_cst) {
+    gc_ptr<TObject> oldObjectPtr;
+    std::lock_guard<gc_lock_type> lock{lock_object_};
+    oldObjectPtr = std::move(object_ptr_);
+    object_ptr_ = std::move(objectPtr);
+    return oldObjectPtr;
+  }
+
+  /**
+   * @brief Stores desiredPtr if atomic_gc_ptr points to the same object as expectedPtr,
+   * otherwise loads current value into expectedPtr
+   */
+  bool compare_exchange_strong(gc_ptr<TObject> & expectedPtr,
+                               gc_ptr<TObject> desiredPtr,
+                               std::memory_order = std::memory_order_seq_cst,
+                               std::memory_order = std::memory_order_seq_cst) {
+    gc_ptr<TObject> oldObjectPtr;
+    bool isExchanged = false;
+    gc_propagation_worklist::runUnbatched([this, &expectedPtr, &desiredPtr, &oldObjectPtr, &isExchanged] {
+      std::lock_guard<gc_lock_type> lock{lock_object_};
+      if (object_ptr_.get() == expectedPtr.get()) {
+        oldObjectPtr = std::move(object_ptr_);
+        object_ptr_ = std::move(desiredPtr);
+        isExchanged = true;
+      } else {
+        oldObjectPtr = object_ptr_;
+      }
+    });
+    if (!isExchanged) {
+      // NOTE(redra): Old value of expectedPtr could be released only after lock, because it could destroy objects
+      expectedPtr = std::move(oldObjectPtr);
+    }
+    return isExchanged;
+  }
+
+  bool compare_exchange_weak(gc_ptr<TObject> & expectedPtr,
+                             gc_ptr<TObject> desiredPtr,
+                             const std::memory_order successOrder = std::memory_order_seq_cst,
+                             const std::memory_order failureOrder = std::memory_order_seq_cst) {
+    return compare_exchange_strong(expectedPtr, std::move(desiredPtr), successOrder, failureOrder);
+  }
+
+ private:
+  gc_ptr<TObject> object_ptr_;
+  mutable gc_lock_type lock_object_;
+};
 
 }
 
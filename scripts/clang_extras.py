@@ -3,6 +3,8 @@
 import os
 import re
 import json
+import hashlib
+import functools
 import sys
 from decimal import Decimal
 from pathlib import Path
@@ -211,27 +213,6 @@ def get_all_classes(cursor: clang.cindex.Cursor):
 
     return found_classes
 
-def esc(code):
-    return f'\033[{code}m'
-
-def validate_all_lambdas(cursor: clang.cindex.Cursor):
-    """
-        Find all references to the type named 'typename'
-        :param cursor: clang.cindex.Cursor
-        :return: None
-        """
-    if hasattr(cursor, 'get_children'):
-        if cursor.kind == CursorKind.CALL_EXPR and 'std::thread' in cursor.type.spelling:
-            validate_all_lambdas.parent_thread_call = True
-        for child in cursor.get_children():
-            if (cursor.kind == CursorKind.LAMBDA_EXPR) and ('memory::gc_ptr' in child.type.spelling):
-                if not hasattr(validate_all_lambdas, 'parent_thread_call') or not validate_all_lambdas.parent_thread_call:
-                    print(f"{esc('31;1;4')}error:{esc(0)} memory::gc_ptr in lambda could be used only in std::thread constructor context(file={cursor.location.file.name}:{cursor.location.line}, column={cursor.location.column})", file=sys.stderr)
-                    exit(1)
-            validate_all_lambdas(child)
-        if cursor.kind == CursorKind.CALL_EXPR and 'std::thread' in cursor.type.spelling:
-            validate_all_lambdas.parent_thread_call = False
-
 
 def get_base_classes(cursor):
     bases = []
@@ -251,33 +232,92 @@ def get_field_decls(cursor):
     return field_decls
 
 
-def filter_files(classes, base_path):
-    project_files = []
-    external_files = []
-    for cl in classes:
-        file_path = os.path.abspath(str(cl.class_decl.location.file))
-        common_directory = os.path.commonpath([base_path, file_path])
-        if base_path in common_directory:
-            project_files.append(file_path)
-        else:
-            external_files.append(file_path)
-    return project_files, external_files
+def get_type_key(type):
+    return type.get_canonical().spelling
 
 
-def group_by_file(classes):
-    group_classes: Dict = dict()
-    for cl in classes:
-        file_path = str(cl.class_decl.location.file)
-        if file_path not in group_classes:
-            group_classes[file_path] = list()
-        group_classes[file_path].append(cl)
-    return group_classes
+def collect_used_classes(type, cached_class_used_gc_ptr, cached_class_used_class, cached_class_file):
+    """
+    Collects graph of types used by type through fields, bases, array elements and template arguments
+    :param cached_class_used_gc_ptr: set of types that directly are gc_ptr or could not be resolved
+    :param cached_class_used_class: dict of type to set of types used by it
+    :param cached_class_file: dict of class type to file that declares it
+    :return: key of type
+    """
+    canonical_type = type.get_canonical()
+    key = canonical_type.spelling
+    if key in cached_class_used_class:
+        return key
+    used_classes = set()
+    cached_class_used_class[key] = used_classes
+    if key.startswith(('memory::gc_ptr<', 'memory::gc_vector<')):
+        cached_class_used_gc_ptr.add(key)
+    elif canonical_type.kind in (TypeKind.CONSTANTARRAY, TypeKind.INCOMPLETEARRAY):
+        used_classes.add(collect_used_classes(canonical_type.element_type,
+                                              cached_class_used_gc_ptr, cached_class_used_class, cached_class_file))
+    elif canonical_type.kind == TypeKind.UNEXPOSED:
+        # NOTE(redra): Dependent type of class template could be anything, so it is traced conservatively
+        cached_class_used_gc_ptr.add(key)
+    elif canonical_type.kind == TypeKind.RECORD:
+        declaration = canonical_type.get_declaration()
+        if declaration.location.file is not None:
+            cached_class_file[key] = os.path.abspath(str(declaration.location.file))
+        for child in declaration.get_children():
+            if child.kind == CursorKind.FIELD_DECL or child.kind == CursorKind.CXX_BASE_SPECIFIER:
+                used_classes.add(collect_used_classes(child.type, cached_class_used_gc_ptr, cached_class_used_class,
+                                                      cached_class_file))
+        for i in range(max(canonical_type.get_num_template_arguments(), 0)):
+            argument_type = canonical_type.get_template_argument_type(i)
+            if argument_type.kind != TypeKind.INVALID:
+                used_classes.add(collect_used_classes(argument_type, cached_class_used_gc_ptr, cached_class_used_class,
+                                                      cached_class_file))
+    return key
+
+
+def may_contain_gc_ptr(type, cached_class_used_gc_ptr, cached_class_used_class, cached_class_file):
+    """
+    Checks if type transitively contains gc_ptr, so tracing of it could not be skipped.
+    Pointers and references are never traced, loops in graph of types are handled by visited set
+    """
+    visited = set()
+    keys = [collect_used_classes(type, cached_class_used_gc_ptr, cached_class_used_class, cached_class_file)]
+    while len(keys) > 0:
+        key = keys.pop()
+        if key in cached_class_used_gc_ptr:
+            return True
+        if key not in visited:
+            visited.add(key)
+            keys.extend(cached_class_used_class[key])
+    return False
+
+
+def get_declaration_files(types, cached_class_used_gc_ptr, cached_class_used_class, cached_class_file):
+    """
+    Collects files that declare classes used by types transitively, so tracing of members of these types
+    depends only on content of these files
+    """
+    visited = set()
+    files = set()
+    keys = [collect_used_classes(type, cached_class_used_gc_ptr, cached_class_used_class, cached_class_file)
+            for type in types]
+    while len(keys) > 0:
+        key = keys.pop()
+        if key not in visited:
+            visited.add(key)
+            if key in cached_class_file:
+                files.add(cached_class_file[key])
+            keys.extend(cached_class_used_class[key])
+    return files
+
+
+def is_project_file(file_path, base_path):
+    return os.path.commonpath([base_path, file_path]) == base_path
 
 
-def group_by_lines(classes: List[ClassDecl]):
+def group_by_lines(classes):
     group_classes: Dict = dict()
     for cl in classes:
-        lines = cl.lines
+        lines = tuple(cl['lines'])
         if lines not in group_classes:
             group_classes[lines] = list()
         group_classes[lines].append(cl)
@@ -301,6 +341,39 @@ def get_include_paths(args):
     return include_paths
 
 
+# NOTE(redra): Headers of these directories are not expected to change between builds, so they are neither hashed
+#              nor cached, together with directories passed by -isystem
+SYSTEM_INCLUDE_PATHS = ('/usr/include', '/usr/local/include', '/usr/lib')
+
+
+def get_system_include_paths(args):
+    system_include_paths = list(SYSTEM_INCLUDE_PATHS)
+    for indx, arg in enumerate(args):
+        if arg == '-isystem' and indx + 1 < len(args):
+            system_include_paths.append(os.path.abspath(args[indx + 1]))
+        elif arg.startswith('-isystem') and len(arg) > len('-isystem'):
+            system_include_paths.append(os.path.abspath(arg[len('-isystem'):]))
+    return system_include_paths
+
+
+def get_parse_flags(args):
+    """
+    Flags that change preprocessing or types of parsed code, so cached metadata of file depends on them
+    """
+    flags = []
+    is_next_flag = False
+    for arg in args:
+        if is_next_flag:
+            flags.append(arg)
+            is_next_flag = False
+        elif arg in ('-D', '-U', '-I', '-isystem', '-include'):
+            flags.append(arg)
+            is_next_flag = True
+        elif arg.startswith(('-D', '-U', '-I', '-isystem', '-include', '-std=')):
+            flags.append(arg)
+    return flags
+
+
 def adjust_args(args):
     new_args = [arg for arg in args if arg]
     idx = 0
@@ -319,8 +392,9 @@ def adjust_args(args):
 def substitute_generated_files(command, generated_file_per_real_file):
     indx = 0
     while indx < len(command):
-        if command[indx] in generated_file_per_real_file:
-            command[indx] = generated_file_per_real_file[command[indx]]
+        real_file = os.path.abspath(command[indx])
+        if real_file in generated_file_per_real_file:
+            command[indx] = generated_file_per_real_file[real_file]
         indx += 1
 
 
@@ -329,7 +403,7 @@ def is_header_file(file):
     return file_extension == '.h' or file_extension == '.hpp'
 
 
-def get_common_path(include_paths):
+def get_common_path(include_paths, file):
     common_paths = []
     for path in include_paths:
         cpath = os.path.commonpath([path, file])
@@ -354,132 +428,322 @@ def generate_relative_includes(command, relative_path, sufixes):
         indx += 1
 
 
-if __name__ == '__main__':
-    # json_file = sys.argv[1]
-    print(f'sys.argv = {sys.argv}')
-    import subprocess
+def hash_bytes(data: bytes):
+    return hashlib.sha256(data).hexdigest()
 
-    command = [f"clang++-{max_clang_ver}"]
-    command.extend(sys.argv[1:])
 
-    build_directory = os.getcwd()
-    args = command[1:]
-    cpp_file = get_compile_file(args)
-    include_paths = get_include_paths(args)
+def hash_file(file_path):
+    try:
+        with open(file_path, 'rb') as f:
+            return hash_bytes(f.read())
+    except OSError:
+        return None
 
-    if cpp_file is None:
-        print(f'command is {command}')
-        exit(subprocess.call(command))
 
-    print(f'build_directory is {build_directory}')
-    print(f'args is {args}')
-    print(f'cpp_file is {cpp_file}')
-    print(f'include_paths is {include_paths}')
+def write_if_changed(file_path, text):
+    """
+    Writes generated file only if its content is changed, so that build system does not rebuild dependent files
+    :return: True if file was written
+    """
+    data = text.encode('utf-8')
+    try:
+        with open(file_path, 'rb') as f:
+            if f.read() == data:
+                return False
+    except OSError:
+        pass
+    # NOTE(redra): File is replaced atomically, so parallel compiles never read partially written file
+    temp_file_path = f'{file_path}.{os.getpid()}.tmp'
+    with open(temp_file_path, 'wb') as f:
+        f.write(data)
+    os.replace(temp_file_path, file_path)
+    return True
+
+@functools.lru_cache(maxsize=None)
+def get_script_hash():
+    return hash_file(__file__) or ''
+
+
+def get_fingerprint(file_path):
+    try:
+        stat = os.stat(file_path)
+    except OSError:
+        return None
+    return {'mtime_ns': stat.st_mtime_ns, 'size': stat.st_size, 'hash': hash_file(file_path)}
+
+
+def is_file_unchanged(file_path, fingerprint):
+    """
+    Checks file against its fingerprint, content is hashed only if size is the same but modification time is not.
+    Fingerprint of touched but unchanged file takes new modification time, so file is not hashed again
+    """
+    try:
+        stat = os.stat(file_path)
+    except OSError:
+        return False
+    if stat.st_size != fingerprint['size']:
+        return False
+    if stat.st_mtime_ns == fingerprint['mtime_ns']:
+        return True
+    if hash_file(file_path) != fingerprint['hash']:
+        return False
+    fingerprint['mtime_ns'] = stat.st_mtime_ns
+    return True
+
+
+class FileMetadataCache:
+    """
+    Cache of traced classes and generated text per file.
+    Entry is keyed by file, flags that change parsing of it and content hash of this script,
+    and is valid while content of file and of files declaring types of its class members is unchanged,
+    so header shared by many translation units is parsed once and unchanged translation unit is not parsed at all
+    """
 
-    index = clang.cindex.Index.create()
+    def __init__(self, build_directory, args):
+        self.cache_dir = os.path.join(build_directory, 'generated', 'cache', 'files')
+        self.flags_key = hash_bytes(json.dumps([get_parse_flags(args), get_script_hash()]).encode('utf-8'))
+        self.system_include_paths = get_system_include_paths(args)
+        self.valid_entries = dict()
 
-    args = adjust_args(args)
-    print(f'adjust_args is {args}')
+    def is_system_file(self, file_path):
+        return any(os.path.commonpath([path, file_path]) == path for path in self.system_include_paths)
+
+    def make_key(self, file_path):
+        return hash_bytes(f'{file_path}\n{self.flags_key}'.encode('utf-8'))
 
+    def entry_path(self, file_path):
+        return os.path.join(self.cache_dir, f'{self.make_key(file_path)}.json')
+
+    def load(self, file_path):
+        """
+        :return: cached entry of file or None, and whether entry is still valid
+        """
+        if file_path in self.valid_entries:
+            return self.valid_entries[file_path], True
+        try:
+            with open(self.entry_path(file_path), 'r') as f:
+                entry = json.load(f)
+        except (OSError, ValueError):
+            return None, False
+        fingerprints = [(file_path, entry['fingerprint'])] + list(entry['type_dependencies'].items())
+        mtimes = [fingerprint['mtime_ns'] for _, fingerprint in fingerprints]
+        if not all(is_file_unchanged(dependency, fingerprint) for dependency, fingerprint in fingerprints):
+            return entry, False
+        if mtimes != [fingerprint['mtime_ns'] for _, fingerprint in fingerprints]:
+            self.store(file_path, entry)
+        self.valid_entries[file_path] = entry
+        return entry, True
+
+    def store(self, file_path, entry):
+        os.makedirs(self.cache_dir, exist_ok=True)
+        write_if_changed(self.entry_path(file_path), json.dumps(entry, indent=2))
+        self.valid_entries[file_path] = entry
+
+    def collect(self, cpp_file):
+        """
+        Walks includes of translation unit through cached entries, system files are skipped
+        :return: valid entries per file and set of files which entries are missing or outdated
+        """
+        entries = dict()
+        stale_files = set()
+        visited = set()
+        files = [os.path.abspath(cpp_file)]
+        while len(files) > 0:
+            file_path = files.pop()
+            if file_path in visited or self.is_system_file(file_path):
+                continue
+            visited.add(file_path)
+            entry, is_valid = self.load(file_path)
+            if is_valid:
+                entries[file_path] = entry
+            else:
+                stale_files.add(file_path)
+            if entry is not None:
+                files.extend(entry['includes'])
+        return entries, stale_files
+
+
+def get_base_spelling(base):
+    spelling = base.spelling
+    record_type = re.search(r'(class|struct)?\s?(?P<type_name>[_A-Za-z][_A-Za-z0-9]*)', spelling)
+    if record_type:
+        spelling = record_type.group('type_name')
+    return spelling
+
+
+def generate_file_text(file_path, classes):
+    """
+    Inserts trace methods before closing brace of every class of file
+    :param classes: cached metadata of classes declared in file
+    """
+    grouped_by_lines_classes = group_by_lines(classes)
+    sorted_lines = list(sorted(grouped_by_lines_classes.keys(), key=lambda x: x[2]))
+    new_lines = []
+    with open(file_path, 'r') as f:
+        lines = f.readlines()
+        indx = 0
+        line_iter = iter(sorted_lines)
+        line = next(line_iter)
+        line_offset = dict()
+        while indx < len(lines):
+            cur_line = lines[indx]
+            if line and line[2] == indx + 1:
+                column_offset = 0
+                if line[2] in line_offset:
+                    column_offset = line_offset[line[2]]
+
+                classes_per_line = grouped_by_lines_classes[line]
+                for cl in classes_per_line:
+                    if cur_line[cl['lines'][3]-2] != '}':
+                        continue
+                    connect_lines = []
+                    for spelling in cl['bases']:
+                        connect_lines.append(f"    memory::call_ConnectBaseToRoot<{spelling}>(this, rootPtr);\n")
+
+                    # NOTE(redra): Fields are traced by compile-time table of pointers to members,
+                    #              so tracing is unrolled by compiler instead of being chain of calls
+                    self_type_line = "    using gc_self_type = std::remove_cv_t<std::remove_pointer_t<decltype(this)>>;\n"
+                    trace_table = "memory::gc_trace_table<" + \
+                                  ", ".join(f"&gc_self_type::{field}" for field in cl['fields']) + ">"
+                    if len(cl['fields']) > 0:
+                        connect_lines.append(self_type_line)
+                        connect_lines.append(f"    {trace_table}::connectToRoot(this, rootPtr);\n")
+
+                    disconnect_lines = []
+                    for spelling in cl['bases']:
+                        disconnect_lines.append(f"    memory::call_DisconnectBaseFromRoot<{spelling}>(this, isRoot, rootPtr);\n")
+
+                    if len(cl['fields']) > 0:
+                        disconnect_lines.append(self_type_line)
+                        disconnect_lines.append(f"    {trace_table}::disconnectFromRoot(this, isRoot, rootPtr);\n")
+
+                    # NOTE(redra): Annotated class without traced members still gets empty trace methods,
+                    #              because it could be pointed by gc_ptr
+                    new_lines.append("\n")
+                    new_lines.append(" public:\n")
+                    new_lines.append("  // GENERATED CODE FOR GC_PTR\n")
+                    new_lines.append("  // BEGIN GC_PTR\n")
+                    if len(connect_lines) > 0:
+                        new_lines.append("  void connectToRoot(const void * rootPtr) const {\n")
+                        for connect_line in connect_lines:
+                            new_lines.append(connect_line)
+                        new_lines.append("  }\n")
+                    else:
+                        new_lines.append("  void connectToRoot(const void *) const {}\n")
+                    new_lines.append("\n")
+                    if len(disconnect_lines) > 0:
+                        new_lines.append("  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {\n")
+                        for disconnect_line in disconnect_lines:
+                            new_lines.append(disconnect_line)
+                        new_lines.append("  }\n")
+                    else:
+                        new_lines.append("  void disconnectFromRoot(const bool, const void *) const {}\n")
+                    new_lines.append("  // END GC_PTR\n")
+                    new_lines.append(cur_line[line[3] - 2 - column_offset:])
+                    try:
+                        line = next(line_iter)
+                    except:
+                        line = None
+            else:
+                new_lines.append(cur_line)
+            indx += 1
+    return ''.join(new_lines)
+
+
+def extract_file_entries(cache, cpp_file, args):
+    """
+    Parses translation unit and stores cache entries of its files which entries are missing or outdated.
+    Only members that transitively contain gc_ptr are kept, so call_ConnectFieldToRoot stops at leaf types
+    at compile time, and files declaring types of all members are recorded, so entry is outdated once they change
+    """
+    index = clang.cindex.Index.create()
     tu = index.parse(cpp_file,
                      args=args,
                      options=0)
-    all_gc_ptrs = set()
-    class_inherited_from = set()
     cached_class_used_gc_ptr = set()
     cached_class_used_class = dict()
-    classes = get_all_classes(tu.cursor)
-    validate_all_lambdas(tu.cursor)
-    project_files, external_files = filter_files(classes, str(Path(build_directory).parent))
-    grouped_by_file_classes = group_by_file(classes)
+    cached_class_file = dict()
+    has_gc_ptr = lambda type: may_contain_gc_ptr(type, cached_class_used_gc_ptr, cached_class_used_class,
+                                                 cached_class_file)
+
+    includes_per_file = {os.path.abspath(cpp_file): set()}
+    for include in tu.get_includes():
+        included_file = os.path.abspath(str(include.include))
+        includes_per_file.setdefault(os.path.abspath(str(include.source)), set()).add(included_file)
+        includes_per_file.setdefault(included_file, set())
+    classes_per_file = dict()
+    for cl in get_all_classes(tu.cursor):
+        classes_per_file.setdefault(os.path.abspath(str(cl.file)), []).append(cl)
+
+    for file_path, includes in includes_per_file.items():
+        if cache.is_system_file(file_path) or cache.load(file_path)[1]:
+            continue
+        fingerprint = get_fingerprint(file_path)
+        if fingerprint is None:
+            continue
+        classes = []
+        type_dependencies = set()
+        for cl in sorted(classes_per_file.get(file_path, []), key=lambda x: x.lines):
+            bases = get_base_classes(cl.class_decl)
+            fields = get_field_decls(cl.class_decl)
+            type_dependencies |= get_declaration_files([member.type for member in bases + fields],
+                                                       cached_class_used_gc_ptr, cached_class_used_class,
+                                                       cached_class_file)
+            classes.append({
+                'lines': list(cl.lines),
+                'bases': [get_base_spelling(base) for base in bases if has_gc_ptr(base.type)],
+                'fields': [field.spelling for field in fields if has_gc_ptr(field.type)],
+            })
+        type_dependencies = sorted(dependency for dependency in type_dependencies
+                                   if dependency != file_path and not cache.is_system_file(dependency))
+        cache.store(file_path, {
+            'fingerprint': fingerprint,
+            'includes': sorted(includes),
+            'type_dependencies': {dependency: get_fingerprint(dependency) for dependency in type_dependencies},
+            'classes': classes,
+            'text': generate_file_text(file_path, classes) if len(classes) > 0 else None,
+        })
+
+
+def load_translation_unit(cache, cpp_file, args):
+    """
+    Collects cache entries of all files of translation unit, translation unit is parsed only if some are outdated
+    :return: entry per file
+    """
+    entries, stale_files = cache.collect(cpp_file)
+    if len(stale_files) > 0:
+        print(f'cache is outdated for {sorted(stale_files)}')
+        extract_file_entries(cache, cpp_file, args)
+        entries, stale_files = cache.collect(cpp_file)
+        for file_path in sorted(stale_files):
+            print(f'{file_path} is changed while {cpp_file} is parsed', file=sys.stderr)
+    return entries
+
+
+def write_outputs(outputs):
+    for output in outputs.values():
+        os.makedirs(os.path.dirname(output['generated_file']), exist_ok=True)
+        write_if_changed(output['generated_file'], output['text'])
 
+
+def generate_outputs(command, build_directory, include_paths, entries):
+    """
+    Places generated text of files of translation unit, extra include flags are inserted into command
+    :return: generated file per real file and outputs of generated files
+    """
+    base_path = str(Path(build_directory).parent)
     generated_file_per_real_file = dict()
-    for file, classes_per_file in grouped_by_file_classes.items():
-        gc_ptr_locations_pre_class = dict()
-        grouped_by_lines_classes = group_by_lines(classes_per_file)
-        sorted_lines = list(sorted(grouped_by_lines_classes.keys(), key=lambda x: x[2]))
-        new_lines = []
-        with open(file, 'r') as f:
-            lines = f.readlines()
-            indx = 0
-            line_iter = iter(sorted_lines)
-            line = next(line_iter)
-            line_offset = dict()
-            while indx < len(lines):
-                cur_line = lines[indx]
-                if line and line[2] == indx + 1:
-                    column_offset = 0
-                    if line[2] in line_offset:
-                        column_offset = line_offset[line[2]]
-
-                    member_names = []
-                    classes_per_line = grouped_by_lines_classes[line]
-                    for cl in classes_per_line:
-                        if cur_line[cl.lines[3]-2] != '}':
-                            continue
-                        bases = get_base_classes(cl.class_decl)
-                        fields = get_field_decls(cl.class_decl)
-
-                        connect_lines = []
-                        for base in bases:
-                            spelling = base.spelling
-                            record_type = re.search(r'(class|struct)?\s?(?P<type_name>[_A-Za-z][_A-Za-z0-9]*)',
-                                                    spelling)
-                            if record_type:
-                                spelling = record_type.group('type_name')
-                            connect_lines.append(f"    memory::call_ConnectBaseToRoot<{spelling}>(this, rootPtr);\n")
-
-                        for field in fields:
-                            spelling = field.spelling
-                            connect_lines.append(f"    memory::call_ConnectFieldToRoot<decltype({spelling})>({spelling}, rootPtr);\n")
-
-                        disconnect_lines = []
-                        for base in bases:
-                            spelling = base.spelling
-                            record_type = re.search(r'(class|struct)?\s?(?P<type_name>[_A-Za-z][_A-Za-z0-9]*)',
-                                                    spelling)
-                            if record_type:
-                                spelling = record_type.group('type_name')
-                            disconnect_lines.append(f"    memory::call_DisconnectBaseFromRoot<{spelling}>(this, isRoot, rootPtr);\n")
-
-                        for field in fields:
-                            spelling = field.spelling
-                            disconnect_lines.append(f"    memory::call_DisconnectFieldFromRoot<decltype({spelling})>({spelling}, isRoot, rootPtr);\n")
-
-                        if len(connect_lines) > 0 or len(disconnect_lines) > 0:
-                            new_lines.append("\n")
-                            new_lines.append(" public:\n")
-                            new_lines.append("  // GENERATED CODE FOR GC_PTR\n")
-                            new_lines.append("  // BEGIN GC_PTR\n")
-                            if len(connect_lines) > 0:
-                                new_lines.append("  void connectToRoot(const void * rootPtr) const {\n")
-                                for connect_line in connect_lines:
-                                    new_lines.append(connect_line)
-                                new_lines.append("  }\n")
-                                new_lines.append("\n")
-                            if len(disconnect_lines) > 0:
-                                new_lines.append("  void disconnectFromRoot(const bool isRoot, const void * rootPtr) const {\n")
-                                for disconnect_line in disconnect_lines:
-                                    new_lines.append(disconnect_line)
-                                new_lines.append("  }\n")
-                            new_lines.append("  // END GC_PTR\n")
-                            new_lines.append(cur_line[line[3] - 2 - column_offset:])
-                            try:
-                                line = next(line_iter)
-                            except:
-                                line = None
-                else:
-                    new_lines.append(cur_line)
-                indx += 1
-
-        abs_file_path = os.path.abspath(file)
-        if abs_file_path in project_files:
+    outputs = dict()
+    for abs_file_path, entry in sorted(entries.items()):
+        if entry['text'] is None:
+            continue
+        if is_project_file(abs_file_path, base_path):
             prefix_gen_dir = '/generated/internal_src'
             common_directory = os.path.commonpath([build_directory, abs_file_path])
             start_of_file_index = abs_file_path.find(common_directory)
             second_part_of_file = abs_file_path[start_of_file_index + len(common_directory):]
             if is_header_file(abs_file_path):
-                common_path = get_common_path(include_paths)
+                common_path = get_common_path(include_paths, abs_file_path)
                 sufixes, longest_sufix = get_sufixes(include_paths, common_path)
                 gen_dir = build_directory + prefix_gen_dir
                 generate_relative_includes(command, gen_dir, sufixes)
@@ -492,11 +756,120 @@ if __name__ == '__main__':
             if header_file_name == 'gc_ptr.hpp':
                 continue
 
-        if not os.path.exists(build_directory + prefix_gen_dir):
-            os.makedirs(build_directory + prefix_gen_dir)
-        generated_file_per_real_file[file] = generated_file
-        with open(generated_file, 'w') as f:
-            f.writelines(new_lines)
+        generated_file_per_real_file[abs_file_path] = generated_file
+        outputs[abs_file_path] = {'generated_file': generated_file, 'text': entry['text']}
+    return generated_file_per_real_file, outputs
+
+
+def read_compile_commands(compile_commands_file):
+    """
+    Reads entries of compile_commands.json, where compiler is this script, so first argument is skipped
+    :return: list of pairs of build directory and compiler arguments, sorted by compiled file
+    """
+    import shlex
+    with open(compile_commands_file, 'r') as f:
+        entries = json.load(f)
+    compile_commands = []
+    for entry in entries:
+        arguments = entry['arguments'] if 'arguments' in entry else shlex.split(entry['command'])
+        compile_commands.append((entry['directory'], arguments[1:]))
+    return sorted(compile_commands, key=lambda x: os.path.join(x[0], get_compile_file(x[1]) or ''))
+
+
+def prepass_translation_unit(compile_command):
+    """
+    Parses single entry of compile_commands.json in worker process and stores cache entries of its outdated files
+    """
+    build_directory, args = compile_command
+    os.chdir(build_directory)
+    args = adjust_args(args)
+    extract_file_entries(FileMetadataCache(build_directory, args), get_compile_file(args), args)
+
+
+def run_prepass(compile_commands_file, jobs):
+    """
+    Fills cache for all translation units of compile_commands.json once per build.
+    Translation units are parsed in parallel by pool of processes, and each generated file is written only once
+    by this process, so following compiles only consume cached results
+    """
+    import multiprocessing
+    compile_commands = [(build_directory, args) for build_directory, args in read_compile_commands(compile_commands_file)
+                        if get_compile_file(args) is not None]
+    parsed_units = set()
+    with multiprocessing.Pool(processes=jobs) as pool:
+        while True:
+            # NOTE(redra): Translation unit is parsed only if some of its outdated files are not covered by
+            #              translation units parsed in the same round, so header shared by them is parsed once
+            units = []
+            covered_keys = set()
+            for indx, (build_directory, args) in enumerate(compile_commands):
+                if indx in parsed_units:
+                    continue
+                os.chdir(build_directory)
+                cache = FileMetadataCache(build_directory, adjust_args(args))
+                _, stale_files = cache.collect(get_compile_file(args))
+                stale_keys = {cache.make_key(file_path) for file_path in stale_files}
+                if not stale_keys <= covered_keys:
+                    units.append(compile_commands[indx])
+                    covered_keys |= stale_keys
+                    parsed_units.add(indx)
+            if len(units) == 0:
+                break
+            pool.map(prepass_translation_unit, units)
+
+    # NOTE(redra): Header shared by many translation units is generated once, first translation unit wins
+    generated_outputs = dict()
+    for build_directory, args in compile_commands:
+        os.chdir(build_directory)
+        command = [f"clang++-{max_clang_ver}"]
+        command.extend(args)
+        cpp_file = get_compile_file(args)
+        entries, _ = FileMetadataCache(build_directory, adjust_args(args)).collect(cpp_file)
+        _, outputs = generate_outputs(command, build_directory, get_include_paths(args), entries)
+        for file, output in outputs.items():
+            generated_output = generated_outputs.setdefault(output['generated_file'], output)
+            if generated_output['text'] != output['text']:
+                print(f'{file} is generated differently for {cpp_file}, first generated version is used',
+                      file=sys.stderr)
+    write_outputs(generated_outputs)
+    print(f'prepass parsed {len(parsed_units)} of {len(compile_commands)} translation units '
+          f'and generated {len(generated_outputs)} files')
+
+
+if __name__ == '__main__':
+    # json_file = sys.argv[1]
+    print(f'sys.argv = {sys.argv}')
+    import subprocess
+
+    if len(sys.argv) > 2 and sys.argv[1] == '--prepass':
+        # NOTE(redra): Usage: clang_extras.py --prepass <compile_commands.json> [--jobs N]
+        jobs = int(sys.argv[sys.argv.index('--jobs') + 1]) if '--jobs' in sys.argv else None
+        run_prepass(os.path.abspath(sys.argv[2]), jobs)
+        exit(0)
+
+    command = [f"clang++-{max_clang_ver}"]
+    command.extend(sys.argv[1:])
+
+    build_directory = os.getcwd()
+    args = command[1:]
+    cpp_file = get_compile_file(args)
+    include_paths = get_include_paths(args)
+
+    if cpp_file is None:
+        print(f'command is {command}')
+        exit(subprocess.call(command))
+
+    print(f'build_directory is {build_directory}')
+    print(f'args is {args}')
+    print(f'cpp_file is {cpp_file}')
+    print(f'include_paths is {include_paths}')
+
+    args = adjust_args(args)
+    print(f'adjust_args is {args}')
+
+    entries = load_translation_unit(FileMetadataCache(build_directory, args), cpp_file, args)
+    generated_file_per_real_file, outputs = generate_outputs(command, build_directory, include_paths, entries)
+    write_outputs(outputs)
 
     command.insert(1, f'-I{build_directory}/generated/external_include/')
     substitute_generated_files(command, generated_file_per_real_file)
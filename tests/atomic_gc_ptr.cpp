@@ -0,0 +1,166 @@
+/**
+ * @file atomic_gc_ptr.cpp
+ * @brief Checks load, store, exchange and compare_exchange of atomic_gc_ptr in one thread,
+ * and that object loaded by one thread with its whole subgraph is not destroyed while other threads store new objects
+ */
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+constexpr int kAliveMark = 0x600d;
+
+std::atomic<int> live_count{0};
+
+class Node {
+ public:
+  explicit Node(const int value)
+    : value_{value} {
+    ++live_count;
+  }
+
+  ~Node() {
+    alive_mark_.store(0);
+    --live_count;
+  }
+
+  int value_;
+  std::atomic<int> alive_mark_{kAliveMark};
+  memory::gc_ptr<Node> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+void testLoadAndStore() {
+  {
+    memory::atomic_gc_ptr<Node> atomicPtr;
+    GC_TEST_CHECK(atomicPtr.load().get() == nullptr);
+
+    atomicPtr.store(memory::make_gc<Node>(1));
+    auto loadedPtr = atomicPtr.load();
+    GC_TEST_CHECK_EQUAL(loadedPtr->value_, 1);
+    GC_TEST_CHECK_EQUAL(live_count.load(), 1);
+
+    atomicPtr = memory::make_gc<Node>(2);
+    GC_TEST_CHECK_EQUAL(static_cast<memory::gc_ptr<Node>>(atomicPtr)->value_, 2);
+    GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+    loadedPtr = nullptr;
+    GC_TEST_CHECK_EQUAL(live_count.load(), 1);
+
+    atomicPtr.store(memory::gc_ptr<Node>{});
+    GC_TEST_CHECK(atomicPtr.load().get() == nullptr);
+    GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+
+    atomicPtr.store(memory::make_gc<Node>(3));
+  }
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+}
+
+void testExchange() {
+  memory::atomic_gc_ptr<Node> atomicPtr{memory::make_gc<Node>(1)};
+  auto oldPtr = atomicPtr.exchange(memory::make_gc<Node>(2));
+  GC_TEST_CHECK_EQUAL(oldPtr->value_, 1);
+  GC_TEST_CHECK_EQUAL(atomicPtr.load()->value_, 2);
+  GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+  oldPtr = nullptr;
+  GC_TEST_CHECK_EQUAL(live_count.load(), 1);
+
+  oldPtr = atomicPtr.exchange(memory::gc_ptr<Node>{});
+  GC_TEST_CHECK_EQUAL(oldPtr->value_, 2);
+  GC_TEST_CHECK(atomicPtr.load().get() == nullptr);
+  oldPtr = nullptr;
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+}
+
+void testCompareExchange() {
+  auto firstPtr = memory::make_gc<Node>(1);
+  memory::atomic_gc_ptr<Node> atomicPtr{firstPtr};
+
+  auto expectedPtr = memory::make_gc<Node>(2);
+  GC_TEST_CHECK(!atomicPtr.compare_exchange_strong(expectedPtr, memory::make_gc<Node>(3)));
+  GC_TEST_CHECK(expectedPtr.get() == firstPtr.get());
+  GC_TEST_CHECK(atomicPtr.load().get() == firstPtr.get());
+  GC_TEST_CHECK_EQUAL(live_count.load(), 1);
+
+  auto desiredPtr = memory::make_gc<Node>(4);
+  GC_TEST_CHECK(atomicPtr.compare_exchange_strong(expectedPtr, desiredPtr));
+  GC_TEST_CHECK(expectedPtr.get() == firstPtr.get());
+  GC_TEST_CHECK(atomicPtr.load().get() == desiredPtr.get());
+
+  expectedPtr = nullptr;
+  firstPtr = nullptr;
+  GC_TEST_CHECK_EQUAL(live_count.load(), 1);
+
+  memory::gc_ptr<Node> weakExpectedPtr;
+  while (!atomicPtr.compare_exchange_weak(weakExpectedPtr, memory::gc_ptr<Node>{})) {
+  }
+  GC_TEST_CHECK(weakExpectedPtr.get() == desiredPtr.get());
+  GC_TEST_CHECK(atomicPtr.load().get() == nullptr);
+  weakExpectedPtr = nullptr;
+  desiredPtr = nullptr;
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+}
+
+void testConcurrentStoreAndLoad() {
+  constexpr int kWritersCount = 2;
+  constexpr int kReadersCount = 2;
+  constexpr int kStoresCount = 2000;
+  {
+    memory::atomic_gc_ptr<Node> atomicPtr{memory::make_gc<Node>(0)};
+    std::atomic<int> runningWritersCount{kWritersCount};
+    std::atomic<bool> isValid{true};
+    std::vector<std::thread> threads;
+    for (int writer = 0; writer < kWritersCount; ++writer) {
+      threads.emplace_back([&atomicPtr, &runningWritersCount] {
+        for (int i = 1; i <= kStoresCount; ++i) {
+          auto nodePtr = memory::make_gc<Node>(i);
+          nodePtr->next_ = memory::make_gc<Node>(-i);
+          if (i % 2 == 0) {
+            atomicPtr.store(std::move(nodePtr));
+          } else {
+            auto expectedPtr = atomicPtr.load();
+            atomicPtr.compare_exchange_strong(expectedPtr, std::move(nodePtr));
+          }
+        }
+        --runningWritersCount;
+      });
+    }
+    for (int reader = 0; reader < kReadersCount; ++reader) {
+      threads.emplace_back([&atomicPtr, &runningWritersCount, &isValid] {
+        while (runningWritersCount.load() > 0) {
+          const auto nodePtr = atomicPtr.load();
+          std::this_thread::yield();
+          if (nodePtr->alive_mark_.load() != kAliveMark) {
+            isValid = false;
+          }
+          if (nodePtr->next_.get() != nullptr &&
+              (nodePtr->next_->alive_mark_.load() != kAliveMark || nodePtr->next_->value_ != -nodePtr->value_)) {
+            isValid = false;
+          }
+        }
+      });
+    }
+    for (auto & thread : threads) {
+      thread.join();
+    }
+    GC_TEST_CHECK(isValid.load());
+    GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+  }
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+}
+
+}
+
+int main() {
+  testLoadAndStore();
+  testExchange();
+  testCompareExchange();
+  testConcurrentStoreAndLoad();
+  return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file batch_scope.cpp
+ * @brief Checks that changes done inside of batch_scope destroy the same objects as the same changes done without it
+ */
+
+#include <array>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+int created_count = 0;
+
+class Node {
+ public:
+  Node()
+    : id_{created_count++} {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  int id_;
+  memory::gc_ptr<Node> a_;
+  memory::gc_ptr<Node> b_;
+  memory::gc_vector<Node> edges_;
+
+  GC_TRACE_FIELDS(a_, b_, edges_)
+};
+
+void testFieldReadsRootsRecordedInsideOfScope() {
+  {
+    memory::gc::batch_scope scope;
+    memory::gc_ptr<Node> r5;
+    memory::gc_ptr<Node> r6;
+    memory::gc_ptr<Node> r7;
+    r7 = memory::make_gc<Node>();
+    r7->a_ = r7;
+    r6 = memory::make_gc<Node>();
+    r5 = r7;
+    r7 = nullptr;
+    r5->a_ = r6;
+    r6->b_ = r5->a_;
+    r6 = nullptr;
+    r5 = nullptr;
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+constexpr std::size_t kRootCount = 6;
+constexpr std::size_t kVectorCount = 2;
+constexpr int kStepCount = 40;
+constexpr int kOperationsPerStep = 8;
+
+bool isOlder(const memory::gc_ptr<Node> & objectPtr, const memory::gc_ptr<Node> & ownerPtr) {
+  return objectPtr.get() == nullptr || objectPtr->id_ < ownerPtr->id_;
+}
+
+/**
+ * @brief Applies the same seeded sequence of changes to roots, fields and vectors,
+ * every step is done inside of its own batch_scope if batched. Fields refer only to older objects,
+ * because cycle detached by reassignment of field is not destroyed even without batch
+ * @return Number of live objects after each step
+ */
+std::vector<int> runOperations(const unsigned seed, const bool batched) {
+  std::mt19937 random{seed};
+  const auto pick = [&random](const std::size_t count) {
+    return std::uniform_int_distribution<std::size_t>{0, count - 1}(random);
+  };
+  std::vector<int> liveCounts;
+  const int baseLiveCount = live_count;
+  {
+    std::array<memory::gc_ptr<Node>, kRootCount> roots;
+    std::array<memory::gc_vector<Node>, kVectorCount> vectors;
+    for (int step = 0; step < kStepCount; ++step) {
+      {
+        std::unique_ptr<memory::gc::batch_scope> scope;
+        if (batched) {
+          scope = std::make_unique<memory::gc::batch_scope>();
+        }
+        for (int operation = 0; operation < kOperationsPerStep; ++operation) {
+          auto & root = roots[pick(kRootCount)];
+          const auto & otherRoot = roots[pick(kRootCount)];
+          auto & vector = vectors[pick(kVectorCount)];
+          switch (pick(10)) {
+            case 0:
+              root = memory::make_gc<Node>();
+              break;
+            case 1:
+              root = otherRoot;
+              break;
+            case 2:
+              root = nullptr;
+              break;
+            case 3:
+              if (root.get() != nullptr && isOlder(otherRoot, root)) {
+                root->a_ = otherRoot;
+              }
+              break;
+            case 4:
+              if (root.get() != nullptr && otherRoot.get() != nullptr && isOlder(otherRoot->a_, root)) {
+                root->b_ = otherRoot->a_;
+              }
+              break;
+            case 5:
+              if (root.get() != nullptr && otherRoot.get() != nullptr && isOlder(otherRoot, root)) {
+                root->edges_.push_back(otherRoot);
+              }
+              break;
+            case 6:
+              if (root.get() != nullptr && !root->edges_.empty()) {
+                root->edges_.pop_back();
+              }
+              break;
+            case 7:
+              if (otherRoot.get() != nullptr) {
+                vector.push_back(otherRoot);
+              }
+              break;
+            case 8:
+              if (!vector.empty()) {
+                vector.pop_back();
+              }
+              break;
+            default:
+              vector.clear();
+              break;
+          }
+        }
+      }
+      liveCounts.push_back(live_count - baseLiveCount);
+    }
+  }
+  liveCounts.push_back(live_count - baseLiveCount);
+  return liveCounts;
+}
+
+void testBatchedOperationsMatchUnbatched() {
+  for (unsigned seed = 1; seed <= 200; ++seed) {
+    const std::vector<int> expectedLiveCounts = runOperations(seed, false);
+    const std::vector<int> liveCounts = runOperations(seed, true);
+    GC_TEST_CHECK_EQUAL(liveCounts.size(), expectedLiveCounts.size());
+    for (std::size_t index = 0; index < liveCounts.size(); ++index) {
+      GC_TEST_CHECK_EQUAL(liveCounts[index], expectedLiveCounts[index]);
+    }
+  }
+}
+
+}
+
+int main() {
+  testFieldReadsRootsRecordedInsideOfScope();
+  testBatchedOperationsMatchUnbatched();
+  return 0;
+}
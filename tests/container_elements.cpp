@@ -0,0 +1,85 @@
+/**
+ * @file container_elements.cpp
+ * @brief Checks that gc_ptr inserted into traced standard container after its owner became reachable
+ * takes roots of owner, so cycles through it are destroyed
+ */
+
+#include <vector>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+
+class Node {
+ public:
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  std::vector<memory::gc_ptr<Node>> children_;
+
+  GC_TRACE_FIELDS(children_)
+};
+
+void testSelfCycleThroughElement() {
+  {
+    auto nodePtr = memory::make_gc<Node>();
+    nodePtr->children_.push_back(nodePtr);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testCycleThroughElements() {
+  {
+    auto firstPtr = memory::make_gc<Node>();
+    auto secondPtr = memory::make_gc<Node>();
+    firstPtr->children_.push_back(secondPtr);
+    secondPtr->children_.push_back(firstPtr);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testElementTakesAllRootsOfOwner() {
+  {
+    auto ownerPtr = memory::make_gc<Node>();
+    ownerPtr->children_.push_back(memory::make_gc<Node>());
+    ownerPtr->children_[0]->children_.push_back(ownerPtr);
+    {
+      auto otherOwnerPtr = ownerPtr;
+      ownerPtr = nullptr;
+      GC_TEST_CHECK_EQUAL(live_count, 2);
+    }
+    GC_TEST_CHECK_EQUAL(live_count, 0);
+  }
+}
+
+void testElementOfOwnerWithSeveralRoots() {
+  {
+    auto ownerPtr = memory::make_gc<Node>();
+    auto otherOwnerPtr = ownerPtr;
+    ownerPtr->children_.push_back(memory::make_gc<Node>());
+    ownerPtr->children_[0]->children_.push_back(ownerPtr);
+    auto thirdOwnerPtr = ownerPtr;
+    otherOwnerPtr = nullptr;
+    ownerPtr = nullptr;
+    GC_TEST_CHECK_EQUAL(live_count, 2);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+}
+
+int main() {
+  testSelfCycleThroughElement();
+  testCycleThroughElements();
+  testElementTakesAllRootsOfOwner();
+  testElementOfOwnerWithSeveralRoots();
+  return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file cycle_collection.cpp
+ * @brief Checks gc_cycle_collection policy: objects outside of cycles are destroyed right away, cycles are destroyed
+ * by collect_cycles() or by threshold, cycles buffered by other alive or exited threads are destroyed as a whole
+ */
+
+#define GC_CYCLE_COLLECTION_THRESHOLD 8
+
+#include <future>
+#include <thread>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+
+class Node {
+ public:
+  using gc_reclamation_policy = memory::gc_cycle_collection;
+
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  memory::gc_ptr<Node> next_;
+  memory::gc_ptr<Node> other_;
+
+  GC_TRACE_FIELDS(next_, other_)
+};
+
+/**
+ * @brief Buffer of main thread is created first, so exited threads do not hand their buffers over to it
+ */
+void createThreadBuffer() {
+  auto nodePtr = memory::make_gc<Node>();
+  auto copyPtr = nodePtr;
+}
+
+void testAcyclicObjectsAreDestroyedRightAway() {
+  {
+    auto headPtr = memory::make_gc<Node>();
+    headPtr->next_ = memory::make_gc<Node>();
+    headPtr->next_->next_ = memory::make_gc<Node>();
+    headPtr->other_ = headPtr->next_->next_;
+    GC_TEST_CHECK_EQUAL(live_count, 3);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 0u);
+}
+
+void testSelfCycle() {
+  {
+    auto nodePtr = memory::make_gc<Node>();
+    nodePtr->next_ = nodePtr;
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 1);
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 1u);
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 0u);
+}
+
+void testCycleWithTail() {
+  {
+    auto aPtr = memory::make_gc<Node>();
+    auto bPtr = memory::make_gc<Node>();
+    aPtr->next_ = bPtr;
+    bPtr->next_ = aPtr;
+    bPtr->other_ = memory::make_gc<Node>();
+    bPtr->other_->next_ = memory::make_gc<Node>();
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 4);
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 4u);
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testReachableCycleIsKept() {
+  auto holderPtr = memory::make_gc<Node>();
+  {
+    auto aPtr = memory::make_gc<Node>();
+    auto bPtr = memory::make_gc<Node>();
+    aPtr->next_ = bPtr;
+    bPtr->next_ = aPtr;
+    holderPtr->next_ = aPtr;
+  }
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 0u);
+  GC_TEST_CHECK_EQUAL(live_count, 3);
+  holderPtr->next_ = nullptr;
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 2u);
+  GC_TEST_CHECK_EQUAL(live_count, 1);
+}
+
+void testThresholdCollectsCycles() {
+  for (int i = 0; i < 4 * GC_CYCLE_COLLECTION_THRESHOLD; ++i) {
+    auto nodePtr = memory::make_gc<Node>();
+    nodePtr->next_ = nodePtr;
+  }
+  GC_TEST_CHECK(live_count < GC_CYCLE_COLLECTION_THRESHOLD);
+  memory::gc::collect_cycles();
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testCycleBufferedByAliveThread() {
+  std::promise<void> isBuffered;
+  std::promise<void> isCollected;
+  std::thread thread;
+  {
+    auto aPtr = memory::make_gc<Node>();
+    auto bPtr = memory::make_gc<Node>();
+    aPtr->next_ = bPtr;
+    bPtr->next_ = aPtr;
+    thread = std::thread{[bPtr, &isBuffered, &isCollected]() mutable {
+      bPtr = nullptr;
+      isBuffered.set_value();
+      isCollected.get_future().wait();
+    }};
+    isBuffered.get_future().wait();
+  }
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 2u);
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+  isCollected.set_value();
+  thread.join();
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 0u);
+}
+
+void testCycleBufferedByExitedThread() {
+  std::thread{[] {
+    auto aPtr = memory::make_gc<Node>();
+    auto bPtr = memory::make_gc<Node>();
+    aPtr->next_ = bPtr;
+    bPtr->next_ = aPtr;
+  }}.join();
+  GC_TEST_CHECK_EQUAL(live_count, 2);
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 2u);
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+}
+
+int main() {
+  createThreadBuffer();
+  testAcyclicObjectsAreDestroyedRightAway();
+  testSelfCycle();
+  testCycleWithTail();
+  testReachableCycleIsKept();
+  testThresholdCollectsCycles();
+  testCycleBufferedByAliveThread();
+  testCycleBufferedByExitedThread();
+  return 0;
+}
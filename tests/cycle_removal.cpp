@@ -0,0 +1,113 @@
+/**
+ * @file cycle_removal.cpp
+ * @brief Checks that cycle whose object holds two gc_ptr to the same object is destroyed
+ * when roots leave scope, objects of cycle are deleted only after propagation over them is finished,
+ * and that cycle collection destroys cycle whose members are buffered by different threads
+ */
+
+#include <thread>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+
+class Node {
+ public:
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  memory::gc_ptr<Node> a_;
+  memory::gc_ptr<Node> b_;
+
+  GC_TRACE_FIELDS(a_, b_)
+};
+
+int collected_live_count = 0;
+
+class CollectedNode {
+ public:
+  using gc_reclamation_policy = memory::gc_cycle_collection;
+
+  CollectedNode() {
+    ++collected_live_count;
+  }
+
+  ~CollectedNode() {
+    --collected_live_count;
+  }
+
+  memory::gc_ptr<CollectedNode> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+void testDoubleEdgeCycle() {
+  {
+    auto a = memory::make_gc<Node>();
+    auto b = memory::make_gc<Node>();
+    a->a_ = b;
+    a->b_ = b;
+    b->a_ = a;
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testDoubleEdgeCycleReleasedInReverseOrder() {
+  {
+    auto b = memory::make_gc<Node>();
+    auto a = memory::make_gc<Node>();
+    a->a_ = b;
+    a->b_ = b;
+    b->a_ = a;
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testSelfCycleWithDoubleEdge() {
+  {
+    auto a = memory::make_gc<Node>();
+    a->a_ = a;
+    a->b_ = a;
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testCycleMemberBufferedByOtherThread() {
+  {
+    // NOTE(redra): Buffer of main thread is created before other thread exits, so it does not take over
+    //  buffer of that thread
+    auto warmUpPtr = memory::make_gc<CollectedNode>();
+    auto warmUpCopyPtr = warmUpPtr;
+  }
+  GC_TEST_CHECK_EQUAL(collected_live_count, 0);
+  {
+    auto xPtr = memory::make_gc<CollectedNode>();
+    auto yPtr = memory::make_gc<CollectedNode>();
+    xPtr->next_ = yPtr;
+    yPtr->next_ = xPtr;
+    std::thread{[yPtr] {
+      auto yCopyPtr = yPtr;
+    }}.join();
+  }
+  GC_TEST_CHECK_EQUAL(collected_live_count, 2);
+  GC_TEST_CHECK_EQUAL(memory::gc::collect_cycles(), 2u);
+  GC_TEST_CHECK_EQUAL(collected_live_count, 0);
+}
+
+}
+
+int main() {
+  testDoubleEdgeCycle();
+  testDoubleEdgeCycleReleasedInReverseOrder();
+  testSelfCycleWithDoubleEdge();
+  testCycleMemberBufferedByOtherThread();
+  return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file deferred_destruction.cpp
+ * @brief Checks gc_destruction_mode::deferred: unreachable objects stay alive until they are drained,
+ * are destroyed in the order they became unreachable, objects dropped by destructors during drain are queued
+ * and drained as well, gc_reclaimer drains queue in background
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+std::atomic<int> live_count{0};
+std::mutex destroyed_ids_mutex;
+std::vector<int> destroyed_ids;
+
+class Node {
+ public:
+  explicit Node(const int id, memory::gc_ptr<Node> * dropOnDestroyPtr = nullptr)
+    : id_{id}
+    , drop_on_destroy_ptr_{dropOnDestroyPtr} {
+    ++live_count;
+  }
+
+  ~Node() {
+    {
+      std::lock_guard<std::mutex> lock{destroyed_ids_mutex};
+      destroyed_ids.push_back(id_);
+    }
+    if (drop_on_destroy_ptr_ != nullptr) {
+      *drop_on_destroy_ptr_ = nullptr;
+    }
+    --live_count;
+  }
+
+  int id_;
+  memory::gc_ptr<Node> * drop_on_destroy_ptr_;
+  memory::gc_ptr<Node> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+std::vector<int> takeDestroyedIds() {
+  std::lock_guard<std::mutex> lock{destroyed_ids_mutex};
+  std::vector<int> ids;
+  ids.swap(destroyed_ids);
+  return ids;
+}
+
+void testObjectsOutliveDropUntilDrain() {
+  {
+    auto nodePtr = memory::make_gc<Node>(1);
+    nodePtr->next_ = memory::make_gc<Node>(2);
+  }
+  GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(1), 1u);
+  GC_TEST_CHECK_EQUAL(live_count.load(), 1);
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(), 1u);
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(), 0u);
+  takeDestroyedIds();
+}
+
+void testDrainIsFifo() {
+  {
+    auto firstPtr = memory::make_gc<Node>(1);
+    auto secondPtr = memory::make_gc<Node>(2);
+    auto thirdPtr = memory::make_gc<Node>(3);
+    secondPtr = nullptr;
+    thirdPtr = nullptr;
+    firstPtr = nullptr;
+  }
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(), 3u);
+  const std::vector<int> ids = takeDestroyedIds();
+  GC_TEST_CHECK_EQUAL(ids.size(), 3u);
+  GC_TEST_CHECK_EQUAL(ids[0], 2);
+  GC_TEST_CHECK_EQUAL(ids[1], 3);
+  GC_TEST_CHECK_EQUAL(ids[2], 1);
+}
+
+void testDestructorDropsObjectsDuringDrain() {
+  memory::gc_ptr<Node> droppedPtr = memory::make_gc<Node>(2);
+  droppedPtr->next_ = memory::make_gc<Node>(3);
+  memory::make_gc<Node>(1, &droppedPtr);
+  GC_TEST_CHECK_EQUAL(live_count.load(), 3);
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(1), 1u);
+  GC_TEST_CHECK(droppedPtr.get() == nullptr);
+  GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(), 2u);
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+  const std::vector<int> ids = takeDestroyedIds();
+  GC_TEST_CHECK_EQUAL(ids.size(), 3u);
+  GC_TEST_CHECK_EQUAL(ids[0], 1);
+}
+
+void testReclaimerDrainsQueue() {
+  {
+    memory::gc_reclaimer reclaimer;
+    for (int i = 0; i < 100; ++i) {
+      auto nodePtr = memory::make_gc<Node>(i);
+      nodePtr->next_ = memory::make_gc<Node>(i);
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+    while (live_count.load() > 0 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  }
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(), 0u);
+  takeDestroyedIds();
+}
+
+}
+
+int main() {
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::deferred);
+  testObjectsOutliveDropUntilDrain();
+  testDrainIsFifo();
+  testDestructorDropsObjectsDuringDrain();
+  testReclaimerDrainsQueue();
+  return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file gc_vector.cpp
+ * @brief Checks that element removed from gc_vector stays alive while it is reachable through remaining elements,
+ * and that own root of vector is removed once no element refers to it
+ */
+
+#include <algorithm>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+
+class Node {
+ public:
+  explicit Node(const int value = 0)
+    : value_{value} {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  int value_;
+  memory::gc_ptr<Node> next_;
+  memory::gc_vector<Node> edges_;
+
+  GC_TRACE_FIELDS(next_, edges_)
+};
+
+void testPopBackOfElementReachableThroughOtherElement() {
+  {
+    memory::gc_vector<Node> vector;
+    auto lastPtr = memory::make_gc<Node>(1);
+    auto firstPtr = memory::make_gc<Node>(2);
+    firstPtr->next_ = lastPtr;
+    vector.push_back(lastPtr);
+    vector.push_back(firstPtr);
+    lastPtr = nullptr;
+    firstPtr = nullptr;
+    vector.pop_back();
+    GC_TEST_CHECK_EQUAL(live_count, 1);
+    GC_TEST_CHECK_EQUAL(vector[0]->value_, 1);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+  {
+    memory::gc_vector<Node> vector;
+    auto lastPtr = memory::make_gc<Node>(1);
+    vector.push_back(lastPtr);
+    vector.push_back(memory::make_gc<Node>(2));
+    vector[1]->next_ = lastPtr;
+    lastPtr = nullptr;
+    vector.set(0, memory::make_gc<Node>(3));
+    GC_TEST_CHECK_EQUAL(live_count, 3);
+    vector.pop_back();
+    GC_TEST_CHECK_EQUAL(live_count, 1);
+    GC_TEST_CHECK_EQUAL(vector[0]->value_, 3);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testCopyAssignmentTakesNewIdentity() {
+  {
+    memory::gc_vector<Node> vector;
+    memory::gc_vector<Node> otherVector;
+    vector.push_back(memory::make_gc<Node>(1));
+    vector[0]->next_ = memory::make_gc<Node>(2);
+    vector[0]->next_->next_ = memory::make_gc<Node>(3);
+    vector[0]->next_->next_->next_ = vector[0]->next_;
+    otherVector.push_back(memory::make_gc<Node>(4));
+    vector = otherVector;
+    GC_TEST_CHECK_EQUAL(live_count, 1);
+    GC_TEST_CHECK_EQUAL(vector[0]->value_, 4);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testCycleThroughFieldVector() {
+  {
+    auto firstPtr = memory::make_gc<Node>();
+    firstPtr->edges_.push_back(memory::make_gc<Node>());
+    firstPtr->edges_[0]->edges_.push_back(firstPtr);
+    firstPtr->edges_.push_back(firstPtr);
+    firstPtr->edges_.pop_back();
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testRandomAccessIterator() {
+  memory::gc_vector<Node> vector;
+  for (int i = 0; i < 4; ++i) {
+    vector.push_back(memory::make_gc<Node>(i));
+  }
+  const auto first = vector.begin();
+  const auto last = vector.end();
+  GC_TEST_CHECK(first < last && last > first && first <= first && last >= first);
+  GC_TEST_CHECK((2 + first) == (first + 2));
+  GC_TEST_CHECK_EQUAL((*(2 + first))->value_, 2);
+  GC_TEST_CHECK_EQUAL(std::distance(first, last), 4);
+  const auto position = std::lower_bound(first, last, 3, [](const Node * nodePtr, const int value) {
+    return nodePtr->value_ < value;
+  });
+  GC_TEST_CHECK_EQUAL(position - first, 3);
+}
+
+}
+
+int main() {
+  testPopBackOfElementReachableThroughOtherElement();
+  testCopyAssignmentTakesNewIdentity();
+  testCycleThroughFieldVector();
+  testRandomAccessIterator();
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+  return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file make_gc.cpp
+ * @brief Checks that make_gc() forwards arguments to constructor or to aggregate initialization
+ * keeping their value category, and constructs object in place without copying or moving it
+ */
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+
+class Node {
+ public:
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  memory::gc_ptr<Node> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+struct Aggregate {
+  int value_;
+  std::string name_;
+  memory::gc_ptr<Node> node_;
+
+  GC_TRACE_FIELDS(node_)
+};
+
+enum class argument_kind {
+  lvalue,
+  rvalue
+};
+
+class Pinned {
+ public:
+  Pinned(std::unique_ptr<int> valuePtr, int & counter, const std::string & name)
+    : value_ptr_{std::move(valuePtr)}
+    , counter_ptr_{&counter}
+    , name_kind_{argument_kind::lvalue} {
+    ++counter;
+  }
+
+  Pinned(std::unique_ptr<int> valuePtr, int & counter, std::string && name)
+    : value_ptr_{std::move(valuePtr)}
+    , counter_ptr_{&counter}
+    , name_kind_{argument_kind::rvalue}
+    , name_{std::move(name)} {
+    ++counter;
+  }
+
+  Pinned(const Pinned &) = delete;
+  Pinned(Pinned &&) = delete;
+  Pinned & operator=(const Pinned &) = delete;
+  Pinned & operator=(Pinned &&) = delete;
+
+  std::unique_ptr<int> value_ptr_;
+  int * counter_ptr_;
+  argument_kind name_kind_;
+  std::string name_;
+  memory::gc_ptr<Node> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+void testAggregateInitialization() {
+  {
+    auto nodePtr = memory::make_gc<Node>();
+    const auto aggregatePtr = memory::make_gc<Aggregate>(7, "seven", nodePtr);
+    nodePtr = nullptr;
+    GC_TEST_CHECK_EQUAL(aggregatePtr->value_, 7);
+    GC_TEST_CHECK(aggregatePtr->name_ == "seven");
+    GC_TEST_CHECK(aggregatePtr->node_.get() != nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 1);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testConstructorArgumentsAreForwarded() {
+  int counter = 0;
+  std::string name = "pinned";
+  const auto lvaluePtr = memory::make_gc<Pinned>(std::make_unique<int>(1), counter, name);
+  GC_TEST_CHECK_EQUAL(*lvaluePtr->value_ptr_, 1);
+  GC_TEST_CHECK(lvaluePtr->counter_ptr_ == &counter);
+  GC_TEST_CHECK(lvaluePtr->name_kind_ == argument_kind::lvalue);
+  GC_TEST_CHECK(name == "pinned");
+  GC_TEST_CHECK_EQUAL(counter, 1);
+
+  const auto rvaluePtr = memory::make_gc<Pinned>(std::make_unique<int>(2), counter, std::move(name));
+  GC_TEST_CHECK_EQUAL(*rvaluePtr->value_ptr_, 2);
+  GC_TEST_CHECK(rvaluePtr->name_kind_ == argument_kind::rvalue);
+  GC_TEST_CHECK(rvaluePtr->name_ == "pinned");
+  GC_TEST_CHECK_EQUAL(counter, 2);
+}
+
+void testAllocateGcForwardsArguments() {
+  int counter = 0;
+  const auto pinnedPtr = memory::allocate_gc<Pinned>(std::allocator<Pinned>{}, std::make_unique<int>(3), counter,
+                                                     std::string{"allocated"});
+  GC_TEST_CHECK_EQUAL(*pinnedPtr->value_ptr_, 3);
+  GC_TEST_CHECK(pinnedPtr->name_kind_ == argument_kind::rvalue);
+  GC_TEST_CHECK_EQUAL(counter, 1);
+}
+
+}
+
+int main() {
+  testAggregateInitialization();
+  testConstructorArgumentsAreForwarded();
+  testAllocateGcForwardsArguments();
+  return 0;
+}
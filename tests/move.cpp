@@ -0,0 +1,129 @@
+/**
+ * @file move.cpp
+ * @brief Checks that move construction and move assignment of gc_ptr hand object over between roots and fields
+ * without keeping it alive through moved-from gc_ptr
+ */
+
+#include <utility>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+
+class Node {
+ public:
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  memory::gc_ptr<Node> next_;
+  memory::gc_ptr<Node> other_;
+
+  GC_TRACE_FIELDS(next_, other_)
+};
+
+void testRootIntoRoot() {
+  {
+    auto nodePtr = memory::make_gc<Node>();
+    nodePtr->next_ = memory::make_gc<Node>();
+    memory::gc_ptr<Node> movedPtr{std::move(nodePtr)};
+    GC_TEST_CHECK(nodePtr.get() == nullptr);
+    GC_TEST_CHECK(movedPtr->next_.get() != nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 2);
+
+    auto otherPtr = memory::make_gc<Node>();
+    GC_TEST_CHECK_EQUAL(live_count, 3);
+    otherPtr = std::move(movedPtr);
+    GC_TEST_CHECK(movedPtr.get() == nullptr);
+    GC_TEST_CHECK(otherPtr->next_.get() != nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 2);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testRootIntoField() {
+  {
+    auto holderPtr = memory::make_gc<Node>();
+    {
+      auto nodePtr = memory::make_gc<Node>();
+      nodePtr->next_ = memory::make_gc<Node>();
+      holderPtr->next_ = std::move(nodePtr);
+      GC_TEST_CHECK(nodePtr.get() == nullptr);
+    }
+    GC_TEST_CHECK_EQUAL(live_count, 3);
+    GC_TEST_CHECK(holderPtr->next_->next_.get() != nullptr);
+
+    auto replacementPtr = memory::make_gc<Node>();
+    holderPtr->next_ = std::move(replacementPtr);
+    GC_TEST_CHECK(replacementPtr.get() == nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 2);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testFieldIntoRoot() {
+  memory::gc_ptr<Node> nodePtr;
+  {
+    auto holderPtr = memory::make_gc<Node>();
+    holderPtr->next_ = memory::make_gc<Node>();
+    holderPtr->next_->next_ = memory::make_gc<Node>();
+    nodePtr = std::move(holderPtr->next_);
+    GC_TEST_CHECK(holderPtr->next_.get() == nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 3);
+
+    holderPtr->other_ = memory::make_gc<Node>();
+    memory::gc_ptr<Node> otherPtr{std::move(holderPtr->other_)};
+    GC_TEST_CHECK(holderPtr->other_.get() == nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 4);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 2);
+  GC_TEST_CHECK(nodePtr->next_.get() != nullptr);
+  nodePtr = nullptr;
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testSelfMoveAssignment() {
+  {
+    auto nodePtr = memory::make_gc<Node>();
+    nodePtr->next_ = memory::make_gc<Node>();
+    auto & rootAlias = nodePtr;
+    nodePtr = std::move(rootAlias);
+    GC_TEST_CHECK(nodePtr.get() != nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 2);
+
+    auto & fieldAlias = nodePtr->next_;
+    nodePtr->next_ = std::move(fieldAlias);
+    GC_TEST_CHECK(nodePtr->next_.get() != nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 2);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+void testMoveOfSameObject() {
+  {
+    auto nodePtr = memory::make_gc<Node>();
+    auto copyPtr = nodePtr;
+    nodePtr = std::move(copyPtr);
+    GC_TEST_CHECK(nodePtr.get() != nullptr);
+    GC_TEST_CHECK_EQUAL(live_count, 1);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+}
+
+}
+
+int main() {
+  testRootIntoRoot();
+  testRootIntoField();
+  testFieldIntoRoot();
+  testSelfMoveAssignment();
+  testMoveOfSameObject();
+  return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file parallel_teardown.cpp
+ * @brief Checks that gc_destruction_mode::parallel destroys every object of dropped graph exactly once,
+ * also when several threads drop their graphs at the same time
+ */
+
+#define GC_PARALLEL_TEARDOWN_THRESHOLD 64
+#define GC_TEARDOWN_THREADS 4
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+constexpr int kObjectCount = 4 * GC_PARALLEL_TEARDOWN_THRESHOLD;
+constexpr int kThreadsCount = 4;
+
+class Node {
+ public:
+  explicit Node(std::atomic<int> * destroyedCountPtr)
+    : destroyed_count_ptr_{destroyedCountPtr} {
+  }
+
+  ~Node() {
+    destroyed_count_ptr_->fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::atomic<int> * destroyed_count_ptr_;
+  memory::gc_ptr<Node> next_;
+  memory::gc_ptr<Node> other_;
+
+  GC_TRACE_FIELDS(next_, other_)
+};
+
+/**
+ * @brief Builds chain of objects where every object also refers to object two steps ahead,
+ * so objects lose their last root together when head is dropped
+ */
+memory::gc_ptr<Node> makeGraph(std::vector<std::atomic<int>> & destroyedCounts, const int first) {
+  memory::gc_ptr<Node> headPtr;
+  for (int i = kObjectCount - 1; i >= 0; --i) {
+    auto nodePtr = memory::make_gc<Node>(&destroyedCounts[first + i]);
+    nodePtr->next_ = headPtr;
+    if (headPtr.get() != nullptr) {
+      nodePtr->other_ = headPtr->next_;
+    }
+    headPtr = nodePtr;
+  }
+  return headPtr;
+}
+
+bool isDestroyedOnce(const std::vector<std::atomic<int>> & destroyedCounts) {
+  for (const auto & destroyedCount : destroyedCounts) {
+    if (destroyedCount.load() != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void testParallelTeardownDestroysEveryObjectOnce() {
+  std::vector<std::atomic<int>> destroyedCounts(kObjectCount);
+  for (int round = 0; round < 3; ++round) {
+    for (auto & destroyedCount : destroyedCounts) {
+      destroyedCount = 0;
+    }
+    auto headPtr = makeGraph(destroyedCounts, 0);
+    GC_TEST_CHECK_EQUAL(destroyedCounts[0].load(), 0);
+    headPtr = nullptr;
+    GC_TEST_CHECK(isDestroyedOnce(destroyedCounts));
+  }
+}
+
+void testConcurrentTeardowns() {
+  std::vector<std::atomic<int>> destroyedCounts(kThreadsCount * kObjectCount);
+  std::vector<memory::gc_ptr<Node>> heads;
+  for (int i = 0; i < kThreadsCount; ++i) {
+    heads.push_back(makeGraph(destroyedCounts, i * kObjectCount));
+  }
+  std::atomic<int> readyCount{0};
+  std::vector<std::thread> threads;
+  for (auto & headPtr : heads) {
+    threads.emplace_back([&headPtr, &readyCount] {
+      auto ownHeadPtr = std::move(headPtr);
+      readyCount.fetch_add(1);
+      while (readyCount.load() < kThreadsCount) {
+        std::this_thread::yield();
+      }
+      ownHeadPtr = nullptr;
+    });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  GC_TEST_CHECK(isDestroyedOnce(destroyedCounts));
+}
+
+}
+
+int main() {
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::parallel);
+  testParallelTeardownDestroysEveryObjectOnce();
+  testConcurrentTeardowns();
+  return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file region.cpp
+ * @brief Checks that object of gc_region that becomes unreachable in deferred destruction mode is deleted once,
+ * before region releases its memory
+ */
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+int live_count = 0;
+int destroyed_count = 0;
+
+class Node {
+ public:
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+    ++destroyed_count;
+  }
+
+  memory::gc_ptr<Node> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+void testUnreachableObjectIsNotQueued() {
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::deferred);
+  {
+    memory::gc_region region;
+    auto & headPtr = region.keep(memory::make_gc<Node>());
+    headPtr->next_ = memory::make_gc<Node>();
+    headPtr->next_->next_ = memory::make_gc<Node>();
+    headPtr->next_ = nullptr;
+    GC_TEST_CHECK_EQUAL(live_count, 1);
+  }
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(), 0u);
+  GC_TEST_CHECK_EQUAL(destroyed_count, 3);
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::immediate);
+}
+
+void testObjectOutsideOfRegionIsQueued() {
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::deferred);
+  {
+    auto outerPtr = memory::make_gc<Node>();
+    memory::gc_region region;
+    auto innerPtr = memory::make_gc<Node>();
+    outerPtr = nullptr;
+    innerPtr = nullptr;
+    GC_TEST_CHECK_EQUAL(live_count, 1);
+  }
+  GC_TEST_CHECK_EQUAL(memory::gc::drain(), 1u);
+  GC_TEST_CHECK_EQUAL(live_count, 0);
+  memory::gc::set_destruction_mode(memory::gc_destruction_mode::immediate);
+}
+
+}
+
+int main() {
+  testUnreachableObjectIsNotQueued();
+  testObjectOutsideOfRegionIsQueued();
+  return 0;
+}
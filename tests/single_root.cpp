@@ -0,0 +1,131 @@
+/**
+ * @file single_root.cpp
+ * @brief Checks objects reachable from single root, which keep root and its count inline without taking lock:
+ * count of root reached through several fields, spilling to root table when second root appears and back
+ * when it is removed, and concurrent removal of two last roots
+ */
+
+#define GC_ENABLE_HEAP_DUMP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+std::atomic<int> live_count{0};
+
+class Node {
+ public:
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  memory::gc_ptr<Node> next_;
+  memory::gc_ptr<Node> other_;
+
+  GC_TRACE_FIELDS(next_, other_)
+};
+
+/**
+ * @return Roots of object with number of gc_ptr that bring each of them
+ */
+std::vector<memory::gc_root_count> rootCountsOf(const memory::gc_ptr<Node> & nodePtr) {
+  for (const auto & object : memory::gc::heap_snapshot().objects_) {
+    if (object.object_ptr_ == nodePtr.get()) {
+      return object.root_counts_;
+    }
+  }
+  return {};
+}
+
+void testRootCountThroughSeveralFields() {
+  {
+    auto ownerPtr = memory::make_gc<Node>();
+    {
+      auto nodePtr = memory::make_gc<Node>();
+      ownerPtr->next_ = nodePtr;
+      ownerPtr->other_ = nodePtr;
+    }
+    auto rootCounts = rootCountsOf(ownerPtr->next_);
+    GC_TEST_CHECK_EQUAL(rootCounts.size(), 1u);
+    GC_TEST_CHECK_EQUAL(rootCounts[0].count_, 2u);
+
+    ownerPtr->other_ = nullptr;
+    rootCounts = rootCountsOf(ownerPtr->next_);
+    GC_TEST_CHECK_EQUAL(rootCounts.size(), 1u);
+    GC_TEST_CHECK_EQUAL(rootCounts[0].count_, 1u);
+    GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+
+    ownerPtr->next_ = nullptr;
+    GC_TEST_CHECK_EQUAL(live_count.load(), 1);
+  }
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+}
+
+void testSpillAndUnspill() {
+  {
+    auto nodePtr = memory::make_gc<Node>();
+    nodePtr->next_ = memory::make_gc<Node>();
+    GC_TEST_CHECK_EQUAL(rootCountsOf(nodePtr->next_).size(), 1u);
+    {
+      auto copyPtr = nodePtr;
+      GC_TEST_CHECK_EQUAL(rootCountsOf(nodePtr).size(), 2u);
+      GC_TEST_CHECK_EQUAL(rootCountsOf(nodePtr->next_).size(), 2u);
+    }
+    GC_TEST_CHECK_EQUAL(rootCountsOf(nodePtr).size(), 1u);
+    GC_TEST_CHECK_EQUAL(rootCountsOf(nodePtr->next_).size(), 1u);
+    GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+
+    auto otherPtr = memory::make_gc<Node>();
+    otherPtr->next_ = nodePtr->next_;
+    nodePtr->next_ = nullptr;
+    GC_TEST_CHECK_EQUAL(rootCountsOf(otherPtr->next_).size(), 1u);
+    GC_TEST_CHECK_EQUAL(live_count.load(), 3);
+  }
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+}
+
+/**
+ * @brief Two threads drop the last two roots of object at once, one of them removes its root under lock
+ * and leaves the other root inline, the other removes the last root without lock
+ */
+void testConcurrentRemovalOfLastRoots() {
+  constexpr int kRoundsCount = 500;
+  for (int round = 0; round < kRoundsCount; ++round) {
+    std::atomic<int> readyCount{0};
+    std::vector<std::thread> threads;
+    {
+      auto nodePtr = memory::make_gc<Node>();
+      nodePtr->next_ = memory::make_gc<Node>();
+      for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([nodePtr, &readyCount]() mutable {
+          readyCount.fetch_add(1);
+          while (readyCount.load() < 2) {
+          }
+          nodePtr = nullptr;
+        });
+      }
+    }
+    for (auto & thread : threads) {
+      thread.join();
+    }
+    GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+  }
+}
+
+}
+
+int main() {
+  testRootCountThroughSeveralFields();
+  testSpillAndUnspill();
+  testConcurrentRemovalOfLastRoots();
+  return 0;
+}
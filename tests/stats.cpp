@@ -0,0 +1,47 @@
+/**
+ * @file stats.cpp
+ * @brief Checks that propagation counts every object it visited, not only objects it started from
+ */
+
+#define GC_ENABLE_STATS
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+class Node {
+ public:
+  memory::gc_ptr<Node> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+constexpr std::size_t kListSize = 101;
+
+void testPropagationTasksOfList() {
+  auto headPtr = memory::make_gc<Node>();
+  Node * nodePtr = headPtr.get();
+  for (std::size_t i = 1; i < kListSize; ++i) {
+    nodePtr->next_ = memory::make_gc<Node>();
+    nodePtr = nodePtr->next_.get();
+  }
+  memory::gc::reset_stats();
+  {
+    const memory::gc_ptr<Node> copyPtr{headPtr};
+    const auto stats = memory::gc::stats();
+    GC_TEST_CHECK_EQUAL(stats.propagations_, 1u);
+    GC_TEST_CHECK_EQUAL(stats.propagation_tasks_, kListSize);
+    GC_TEST_CHECK(stats.averagePropagationDepth() == static_cast<double>(kListSize));
+  }
+  const auto stats = memory::gc::stats();
+  GC_TEST_CHECK_EQUAL(stats.propagations_, 2u);
+  GC_TEST_CHECK_EQUAL(stats.propagation_tasks_, 2 * kListSize);
+}
+
+}
+
+int main() {
+  testPropagationTasksOfList();
+  return 0;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file test_check.hpp
+ * @brief Minimal checks for tests, failed check prints its location and aborts
+ */
+
+#ifndef GC_PTR_TEST_CHECK_HPP
+#define GC_PTR_TEST_CHECK_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+#define GC_TEST_CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::abort(); \
+    } \
+  } while (false)
+
+#define GC_TEST_CHECK_EQUAL(actual, expected) \
+  do { \
+    const auto actualValue = (actual); \
+    const auto expectedValue = (expected); \
+    if (!(actualValue == expectedValue)) { \
+      std::fprintf(stderr, "%s:%d: check failed: %s == %s, %lld != %lld\n", __FILE__, __LINE__, #actual, #expected, \
+                   static_cast<long long>(actualValue), static_cast<long long>(expectedValue)); \
+      std::abort(); \
+    } \
+  } while (false)
+
+#endif //GC_PTR_TEST_CHECK_HPP
@@ -0,0 +1,80 @@
+/**
+ * @file weak_ptr.cpp
+ * @brief Checks that gc_weak_ptr::lock() keeps object alive only while it is reachable and that object
+ * moved to root table by lock() returns to single root state when locked gc_ptr is gone
+ */
+
+#include <thread>
+
+#include <test_check.hpp>
+#include <gc_ptr.hpp>
+
+namespace {
+
+std::atomic<int> live_count{0};
+
+class Node {
+ public:
+  Node() {
+    ++live_count;
+  }
+
+  ~Node() {
+    --live_count;
+  }
+
+  memory::gc_ptr<Node> next_;
+
+  GC_TRACE_FIELDS(next_)
+};
+
+void testLockWhileReachable() {
+  memory::gc_weak_ptr<Node> weakPtr;
+  {
+    auto headPtr = memory::make_gc<Node>();
+    headPtr->next_ = memory::make_gc<Node>();
+    weakPtr = headPtr->next_;
+    for (int i = 0; i < 3; ++i) {
+      auto lockedPtr = weakPtr.lock();
+      GC_TEST_CHECK(lockedPtr.get() != nullptr);
+      auto otherLockedPtr = weakPtr.lock();
+      GC_TEST_CHECK(otherLockedPtr.get() == lockedPtr.get());
+    }
+    auto lockedPtr = weakPtr.lock();
+    headPtr->next_ = nullptr;
+    GC_TEST_CHECK_EQUAL(live_count.load(), 2);
+    GC_TEST_CHECK(!weakPtr.expired());
+  }
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+  GC_TEST_CHECK(weakPtr.expired());
+  GC_TEST_CHECK(weakPtr.lock().get() == nullptr);
+}
+
+void testLockConcurrentlyWithRootUpdates() {
+  constexpr int kIterations = 20000;
+  auto headPtr = memory::make_gc<Node>();
+  headPtr->next_ = memory::make_gc<Node>();
+  headPtr->next_->next_ = memory::make_gc<Node>();
+  const memory::gc_weak_ptr<Node> weakPtr{headPtr->next_};
+  std::thread lockThread{[&weakPtr] {
+    for (int i = 0; i < kIterations; ++i) {
+      auto lockedPtr = weakPtr.lock();
+      GC_TEST_CHECK(lockedPtr.get() != nullptr);
+    }
+  }};
+  for (int i = 0; i < kIterations; ++i) {
+    auto copyPtr = headPtr;
+    auto otherCopyPtr = headPtr;
+  }
+  lockThread.join();
+  headPtr = nullptr;
+  GC_TEST_CHECK_EQUAL(live_count.load(), 0);
+}
+
+}
+
+int main() {
+  testLockWhileReachable();
+  testLockConcurrentlyWithRootUpdates();
+  return 0;
+}